@@ -38,388 +38,1786 @@
 #include <Arduino.h>
 #include <U8g2lib.h>
 #include <SPI.h>
-#include <Wire.h>
 
-    uint8_t frame[20]= {255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255} ; // buffer for i2c received data  
+//#define TWI_DIRECT                   // own TWI slave interrupt instead of the Wire library, see the TWI slave section
+//#define RX_CYCLES                    // measure the CPU cycles the TWI interrupt takes per frame at startup, see below
+
+#ifdef TWI_DIRECT
+  #include <util/twi.h>
+#else
+  #include <Wire.h>
+#endif
+
+//#define FRAME_REPLAY                  // replay the transactions of replayData[] through receiveEvent(), no meter needed
+#define REPLAY_PERIOD 30               // ms between two replayed frames, 0 replays as fast as possible
+//#define FRAME_CRC                    // print a CRC of the whole screen after each frame rendered (golden image check)
+//#define I2C_RECORD                   // stream every raw I2C transaction over Serial, see the capture format below
+//#define TELEMETRY                    // stream every new reading over Serial as a binary record, see the telemetry section
+
+#ifdef FRAME_REPLAY
+  #define i2cBus replayBus             // receiveEvent() reads the replayed bytes instead of the Wire buffer
+#else
+  #define i2cBus Wire
+#endif
+
+    uint8_t frame[20]= {255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255} ; // frame being rendered  
+
+// ************************* frame double buffer ***********************
+// receiveEvent() runs inside the TWI interrupt so it only feeds the bytes to the PCF8576 emulation below.
+// The emulated display RAM is frameSlot[fillSlot] itself, once it has been completely rewritten it is
+// published as the latest complete frame and the other slot becomes the one to fill, nothing is copied.
+// loop() copies the newest frame into frame[] and renders it, a frame published before loop() got to it
+// is counted as dropped.
+
+//#define FRAME_STATS                  // print the frame counters and render cost over Serial once a second
+//#define RENDER_BENCH                 // time the rendering at startup and print it over Serial, see renderBench()
+//#define CYCLE_BENCH                  // count the CPU cycles of each stage on the replayed frames at startup, see cycleBench()
+
+#if defined(FRAME_STATS) || defined(RENDER_BENCH) || defined(CYCLE_BENCH)
+  #define STAT(x) x
+#else
+  #define STAT(x)
+#endif
+
+    volatile uint8_t frameSlot[2][20]= {{255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255},
+                                        {255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255,255}};
+    volatile uint8_t fillSlot = 0;     // slot receiveEvent() is writing to
+    volatile int8_t  readySlot = -1;   // latest complete frame, -1 when there is nothing new
+
+    volatile uint32_t framesReceived = 0;  // complete frames published by pcfEnd()
+    volatile uint32_t framesDropped = 0;   // frames overwritten by a newer one before being rendered
+    uint32_t framesRendered = 0;           // frames drawn by loop()
+    uint32_t framesUnchanged = 0;          // frames identical to the one on screen, not redrawn
+
+    uint32_t drawCalls = 0;                // u8g2 draw calls, all pages included
+    uint32_t spiBytes = 0;                 // pixel data sent to the display, an 8x8 tile is TILE_BYTES bytes
+    uint32_t renderMicros = 0;             // time spent in transcode() / transcodeDirty()
+    uint32_t renderMicrosMax = 0;          // slowest frame
+
+#ifdef RX_CYCLES
+// Both receive paths are measured the same way, from outside : once the bus is started setup() spends
+// RX_WINDOW Timer1 periods (65536 cycles each, about 2 s in all) reading TCNT1 back to back, with the millis()
+// interrupt stopped and Serial flushed. Every gap between two reads longer than the shortest one is an
+// interrupt, and with nothing else enabled that is the TWI one, taken whole : vector, register saves, handler
+// and reti. With Wire that is its byte by byte buffer filling and the call of receiveEvent() at the STOP, with
+// TWI_DIRECT our own handler. The meter must be on the bus. rxMeasure() prints once
+//   rx wire cycles/frame .. longest .. frames ..        (rx twi_direct ... with TWI_DIRECT)
+// Build once with and once without TWI_DIRECT : the difference of cycles/frame is what TWI_DIRECT saves per
+// frame, longest is the latency the receive path adds to the rest of the sketch.
+  #ifdef FRAME_REPLAY
+    #error "RX_CYCLES measures the TWI interrupt, it needs the meter on the bus and not FRAME_REPLAY"
+  #endif
+  #define RX_WINDOW 500
+#endif
+
+// ************************* stage profile ***********************
+// Times every stage of the path from the meter to the screen with micros() (4 us resolution) :
+//   rx      one I2C transaction fed to the PCF8576 emulation (receiveEvent() or the TWI interrupts)
+//   decode  decodeFrame(), segments to characters, unit and prefix
+//   draw    drawState() calls of one frame, all pages or tile rows included
+//   flush   sending the page buffer to the SSD1322 over SPI, all pages or tile rows included
+// Each stage keeps count, min, mean, max and a histogram where bucket b counts the times from 2^b to
+// 2^(b+1)-1 us (0 and 1 us go in bucket 0). printProfile() prints them every PROFILE_PERIOD ms, or when
+// any character is received on Serial, then starts a new window. Nothing of it is compiled without
+// STAGE_PROFILE. CYCLE_BENCH uses the same PROF() hooks to count CPU cycles instead, see cycleBench().
+
+//#define STAGE_PROFILE                // time each stage, report over Serial
+#define PROFILE_PERIOD 5000            // ms between two reports, 0 reports only on demand
+
+#if defined(STAGE_PROFILE) || defined(CYCLE_BENCH)
+  #define PROF(...) __VA_ARGS__
+
+    enum { STAGE_RX, STAGE_DECODE, STAGE_DRAW, STAGE_FLUSH, STAGE_COUNT };
+    const char stageName[][7] PROGMEM = { "rx", "decode", "draw", "flush" };
+#else
+  #define PROF(...)
+#endif
+
+#ifdef CYCLE_BENCH
+  #ifdef STAGE_PROFILE
+    #error "CYCLE_BENCH and STAGE_PROFILE both use the PROF() hooks, enable only one of them"
+  #endif
+  #define PROF_NOW() benchCycles()     // CPU cycles, see the cycle benchmark
+#else
+  #define PROF_NOW() micros()
+#endif
+
+#ifdef STAGE_PROFILE
+    #define STAGE_BUCKETS 16
+
+    struct StageStats {
+      uint32_t n;
+      uint32_t sum;                    // us
+      uint16_t min, max;               // us, 65535 max
+      uint16_t hist[STAGE_BUCKETS];    // saturates at 65535
+    };
+    StageStats stages[STAGE_COUNT];    // STAGE_RX is written from the TWI interrupt
+#endif
  
     char value[8]={0,0,0,0,0,0,0,0};  // value to display 
 
+// ************************* PCF8576 emulation ***********************
+// The command and data parsing is in PM2525_pcf.h, shared with the host tools. Its display RAM is the slot
+// being filled, pcf.ram[n] holds columns 2n and 2n+1 which is the frame[] layout.
+
+//#define PCF_SUBADDRESS 0             // only keep the data sent to that subaddress (A2 A1 A0), all by default
+
+#include "PM2525_pcf.h"
+
+    // display enabled in 1:4 mode until the meter says otherwise
+    Pcf8576 pcf = {(uint8_t *)frameSlot[0], PCF_CMD, 0, 0, {0, 0, 0, 0, 0}, 0x08, 0, 0};
+
+// The LCD goes blank when the mode set command clears E, and blinks as a whole after a blink command with
+// BF1 BF0 = 2, 1 or 0.5 Hz (the alternate RAM bank blink doesn't exist in 1:4 mode). blinkUpdate() follows
+// both by switching the panel off and on, one command each time : the picture stays in the display RAM so
+// nothing is decoded, drawn or sent again.
+#define PCF_BLINK                      // comment out to ignore the blink and display enable commands
+
+#ifdef PCF_BLINK
+    bool panelOn = true;               // panel state set by blinkUpdate()
+#endif
+ 
+
 // ************************* glyph definitions ***********************
+// the glyphs are XBM files in assets/glyphs compiled by tools/glyph_assets.py into PM2525_glyphs.h, kept in
+// flash and drawn with drawXBMP()
 
-   // Ohms glyph
-    #define OMEGA_width 14
-    #define OMEGA_height 16
-    static unsigned char OMEGA_bits[] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xe0, 0x01,
-    0xf8, 0x07, 0x1c, 0x0e, 0x0c, 0x0c, 0x06, 0x18,
-    0x06, 0x18, 0x06, 0x18, 0x06, 0x18, 0x0c, 0x0c,
-    0x18, 0x06, 0x18, 0x06, 0x1e, 0x1e, 0x1e, 0x1e};
-    
-   // zap glyph
-    #define ZAP_width 12
-    #define ZAP_height 9
-    static unsigned char ZAP_bits[] = {
-    0x00, 0x08, 0x00, 0x0c, 0x20, 0x06, 0x70, 0x03,
-    0xd8, 0x01, 0x8d, 0x00, 0x07, 0x00, 0x07, 0x00,
-    0x0f, 0x00}; 
-     
- // S glyph
-    #define S_width 5
-    #define S_height 7
-    static unsigned char S_bits[] = {
-    0x0e, 0x01, 0x01, 0x0e, 0x10, 0x10, 0x0e};
-
- // up arrow 2 ( on the top left corner
-    #define UPARROW2_width 7
-    #define UPARROW2_height 7
-    static unsigned char UPARROW2_bits[] = {
-    0x08, 0x1c, 0x2a, 0x49, 0x08, 0x08, 0x08};
-     
- // decimal dot  
-    #define DP_width 2
-    #define DP_height 2
-    static unsigned char DP_bits[] = {
-    0x03, 0x03};
-    
- // loudspeaker glyph 
-    #define lsp_width 8
-    #define lsp_height 7
-    static unsigned char lsp_bits[] = {
-    0x60, 0x50, 0x4e, 0x46, 0x4e, 0x50, 0x60};
+#include "PM2525_glyphs.h"
 
-    
-  // diode glyph
-    #define diode_width 8
-    #define diode_height 7
-    static unsigned char diode_bits[] = {
-    0x00, 0x24, 0x34, 0xff, 0x34, 0x24, 0x00};
-
-    // DC glyph
-    #define DC_width 8
-    #define DC_height 6
-    static unsigned char DC_bits[] = {
-    0xff, 0x00, 0x00, 0xdb, 0x00, 0x00};
-    
-   // AC glyph
-    #define AC_width 7
-    #define AC_height 3
-    static unsigned char AC_bits[] = {
-    0x06, 0x49, 0x30};
-
-   // DC glygh on to of the AC symbol
-    #define DCAC_width 7
-    #define DCAC_height 1
-    static unsigned char DCAC_bits[] = {
-    0x7f};
-
-   // DOWN ARROW on upper right
-    #define DNARROW_width 5
-    #define DNARROW_height 3
-    static unsigned char DNARROW_bits[] = {
-    0x11, 0x0a, 0x04};
-
-   // UP ARROW on the upper right
-    #define UPARROW_width 5
-    #define UPARROW_height 3
-    static unsigned char UPARROW_bits[] = {
-    0x04, 0x0a, 0x11};   
-
-   // Z glyph
-    #define Z_width 9
-    #define Z_height 11
-    static unsigned char Z_bits[] = {
-    0x00, 0x00, 0xfc, 0x00, 0x80, 0x00, 0x40, 0x00,
-    0x20, 0x00, 0x10, 0x00, 0x08, 0x00, 0x04, 0x00,
-    0x02, 0x00, 0x7e, 0x00, 0x00, 0x00};
-
-   // function arrows at the bottom line (won't line up with the bezel though)
-    #define FCTARROW_width 5
-    #define FCTARROW_height 6
-    static unsigned char FCTARROW_bits[] = {
-    0x04, 0x04, 0x04, 0x1f, 0x0e, 0x04};
-    
-   // rising edge 
-    #define R_EDGE_width 14
-    #define R_EDGE_height 16
-    static unsigned char R_EDGE_bits[] = {
-    0x00, 0x00, 0x00, 0x00, 0x80, 0x0f, 0x80, 0x00,
-    0x80, 0x00, 0x80, 0x00, 0x80, 0x00, 0xc0, 0x01,
-    0xe0, 0x03, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00,
-    0x80, 0x00, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-   // fallling edge 
-    #define F_EDGE_width 14
-    #define F_EDGE_height 16
-    static unsigned char F_EDGE_bits[] = {
-    0x00, 0x00, 0x00, 0x00, 0xfc, 0x00, 0x80, 0x00,
-    0x80, 0x00, 0x80, 0x00, 0x80, 0x00, 0xe0, 0x03,
-    0xc0, 0x01, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00,
-    0x80, 0x00, 0x80, 0x0f, 0x00, 0x00, 0x00, 0x00};
-
-   
-// construtor usage U8G2_SSD1322_NHD_256X64_1_4W_HW_SPI(rotation, cs, dc [, reset]) [page buffer, size = 256 bytes]
-    U8G2_SSD1322_NHD_256X64_1_4W_HW_SPI u8g2(U8G2_R2, 5, 3, 4); // OLED init
+
+// ************************* panel ***********************
+// The screen is laid out for the 256x64 SSD1322 and the sketch also builds for smaller panels, picked with
+// PANEL. Each one comes with its u8g2 constructor, its size and a Layout : where the readout, the unit and
+// the bargraph go, and which fonts they use. The 240 pixel wide panel takes the SSD1322 layout as it is (it
+// ends at x = 232), the 128 pixel wide ones have smaller fonts and their own annunDesc[] table. All of it is
+// resolved at compile time, the drawing code is the same for every panel.
+
+#define PANEL_SSD1322_256X64  1        // 3.12" OLED, 16 gray levels, the original layout
+#define PANEL_UC1611_240X64   2        // EA DOGM240-6 LCD
+#define PANEL_SSD1306_128X64  3        // 0.96" OLED modules
+#define PANEL_SH1106_128X64   4        // 1.3" OLED modules
+
+#define PANEL PANEL_SSD1322_256X64
+
+#if PANEL == PANEL_SSD1322_256X64
+  #define PANEL_W 256
+  #define PANEL_U8G2(buf) U8G2_SSD1322_NHD_256X64_##buf##_4W_HW_SPI
+  #define TILE_BYTES 32                // bytes sent for an 8x8 tile, the SSD1322 has 4 bits per pixel
+#elif PANEL == PANEL_UC1611_240X64
+  #define PANEL_W 240
+  #define PANEL_U8G2(buf) U8G2_UC1611_EA_DOGM240_##buf##_4W_HW_SPI
+  #define TILE_BYTES 8
+#elif PANEL == PANEL_SSD1306_128X64
+  #define PANEL_W 128
+  #define PANEL_U8G2(buf) U8G2_SSD1306_128X64_NONAME_##buf##_4W_HW_SPI
+  #define TILE_BYTES 8
+#elif PANEL == PANEL_SH1106_128X64
+  #define PANEL_W 128
+  #define PANEL_U8G2(buf) U8G2_SH1106_128X64_NONAME_##buf##_4W_HW_SPI
+  #define TILE_BYTES 8
+#else
+  #error "PANEL is one of the PANEL_xx above"
+#endif
+#define PANEL_H 64
+#define PANEL_TILES (PANEL_W / 8)      // tile columns, at most 32 (one bit each in dirtyTiles[])
+
+    struct Layout {
+      uint8_t top;                     // baseline of the top line, the annunciators are placed from it
+      uint8_t barX, barPitch;          // first end mark of the bargraph, distance between two segments
+      uint8_t readY;                   // baseline of the readout
+      uint8_t signX, digitX, digitPitch;   // character origins, digit i is at digitX + i*digitPitch
+      uint8_t cellY, cellH;            // rows covered by a readout character
+      uint8_t unitX, unit2X, unitW;    // unit field, the prefix glyph is at unitX and the unit glyph at unit2X
+    };
+
+#if PANEL_W >= 240
+    constexpr Layout LAY = {13, 88, 4, 13+36, 4, 21, 17, 13+15, 28, 138, 152, 29};
+    #define READOUT_FONT u8g2_font_inr19_mf
+    #define UNIT_FONT    u8g2_font_inr16_mf
+#else
+    constexpr Layout LAY = {6, 80, 2, 27, 0, 10, 10, 10, 22, 84, 98, 29};
+    #define READOUT_FONT u8g2_font_10x20_mf
+    #define UNIT_FONT    u8g2_font_9x15_mf
+#endif
+    #define BAR(n) (LAY.barX + (n)*LAY.barPitch)     // bargraph position n, 0 and 16 are the end marks
+
+
+// ************************* decoded display state ***********************
+// what is actually shown, decoded from frame[] by decodeFrame(). The meter resends the same frame every 30 ms
+// so loop() compares it with the state on screen and only calls transcode() when something changed.
+// The decoding itself is in PM2525_decode.h, shared with the host tools.
+
+#include "PM2525_decode.h"
+
+
+    // characters of the PFX_xx and UNIT_xx codes of PM2525_decode.h
+    const char prefixChar[] = {' ', ' ', ' ', 'V', (char)0xb5, 'n', 'd', 'k', 'M', 'm', (char)0xB0, '%'};  // 0xb5 micro, 0xb0 '°'
+    const char unitChar[] = {' ', ' ', ' ', 'P', 'H', 'F', 'B', 'V', 'A', ' ', 'C'};  // edges and omega are glyphs
+
+    DisplayState shown;              // state currently on the screen
+    bool shownValid = false;         // nothing drawn yet
+
+    const int yfirtsline = LAY.top;  // baseline of the top line, everything else is placed from it
+
+// ************************* dual core ***********************
+// On a board with two cores (RP2040 with the arduino-pico core) DUAL_CORE splits the path in two : core 0
+// receives the frames (I2C interrupt and PCF8576 emulation) and decodes them in loop(), core 1 draws and
+// sends them in loop1(). The DisplayStates go from one core to the other through a LatestBox of
+// PM2525_pipeline.h, without locks : core 0 never waits for the display, core 1 always draws the newest state
+// and the ones decoded while it was busy are skipped, as frameSlot[] does for the frames. Everything that
+// talks to the display (rendering, trend, blink) runs on core 1, Serial is only used on core 0.
+// tools/pipeline_stress.cpp runs the same hand over with two threads on a PC.
+
+//#define DUAL_CORE                    // decode on core 0, render on core 1 (RP2040)
+
+#ifdef DUAL_CORE
+  #ifndef ARDUINO_ARCH_RP2040
+    #error "DUAL_CORE needs the second core of an RP2040 board (arduino-pico core)"
+  #endif
+  #if defined(FRAME_CRC) || defined(STAGE_PROFILE) || defined(RENDER_BENCH) || defined(CYCLE_BENCH)
+    #error "FRAME_CRC, STAGE_PROFILE and the benchmarks expect everything on one core, disable DUAL_CORE"
+  #endif
+  #include "PM2525_pipeline.h"
+
+    LatestBox<DisplayState> stateBox;        // decoded by loop(), drawn by loop1()
+    std::atomic<bool> displayReady(false);   // set at the end of setup(), core 1 doesn't touch the display before
+#endif
+
+// pre-rendered readout characters, generated by tools/readout_sprites.py for the SSD1322 layout. Without it
+// the readout is drawn with the font like the rest
+#if __has_include("PM2525_readout.h") && PANEL == PANEL_SSD1322_256X64
+  #include "PM2525_readout.h"
+  static_assert(READOUT_BASELINE == LAY.readY, "PM2525_readout.h is for another baseline, run tools/readout_sprites.py again");
+#endif
+
+// ************************* annunciators ***********************
+// every annunciator is one line of annunDesc[] : which bit of which annun[] byte turns it on, where it goes
+// and what is drawn there (tom thumb text, inverted text or XBM glyph). drawState() walks the table, skipping
+// the bits that are off and the entries outside of the current page, and markChanges() uses the same table to
+// find what to redraw. The battery and Y3 segments are not decoded yet, once their bit is known they are one
+// more line in the table.
+
+    enum { K_STR, K_INV, K_XBM };    // tom thumb text, DrawInvStr() text, XBM glyph
+
+    enum { T_REM, T_SRQ, T_LSTN, T_TLK, T_ONLY, T_2W, T_4W, T_HF, T_SHFT, T_LIM,
+           T_DELTA, T_CAL, T_AXB, T_MIN, T_MAX, T_READ, T_BURST, T_SEQU, T_DELAY, T_ZERO, T_SET, T_MRNG,
+           T_STRG, T_SPEED, T_1, T_2, T_3, T_4, T_FILT, T_NULL, T_HOLD, T_PROBE };
+    const char annunText[][7] PROGMEM = {"REM", "SRQ", "LSTN", "TLK", "ONLY", "2w", "4w", "HF",
+      "SHFT", "LIM", "DELTA%", "CAL", "AX+B", "MIN", "MAX", "READ", "BURST", "SEQU", "DELAY", "ZERO", "SET",
+      "M RNG", "S TRG", "SPEED", "1", "2", "3", "4", "FILT", "NULL", "HOLD", "PROBE"};
+
+// the K_INV texts pre-rendered by tools/inv_labels.py, drawn by drawInvLabel() instead of DrawInvStr()
+#if __has_include("PM2525_labels.h")
+  #include "PM2525_labels.h"
+  static_assert(sizeof(invLabels)/sizeof(invLabels[0]) == INV_LABEL_LAST - INV_LABEL_FIRST + 1,
+                "PM2525_labels.h is for other annunciators, run tools/inv_labels.py again");
+#endif
+
+    struct AnnunXbm { uint8_t w, h; const unsigned char *bits; };   // bits in flash too
+    enum { X_LSP, X_DIODE, X_AC, X_DC, X_DCAC, X_DNARROW, X_UPARROW, X_Z, X_ZAP, X_UPARROW2, X_FCTARROW, X_S };
+    const AnnunXbm annunXbm[] PROGMEM = {
+      {lsp_width, lsp_height, lsp_bits},
+      {diode_width, diode_height, diode_bits},
+      {AC_width, AC_height, AC_bits},
+      {DC_width, DC_height, DC_bits},
+      {DCAC_width, DCAC_height, DCAC_bits},
+      {DNARROW_width, DNARROW_height, DNARROW_bits},
+      {UPARROW_width, UPARROW_height, UPARROW_bits},
+      {Z_width, Z_height, Z_bits},
+      {ZAP_width, ZAP_height, ZAP_bits},
+      {UPARROW2_width, UPARROW2_height, UPARROW2_bits},
+      {FCTARROW_width, FCTARROW_height, FCTARROW_bits},
+      {S_width, S_height, S_bits}};
+
+    struct AnnunDesc { uint8_t ann, mask, x, y, kind, asset; };
+#if PANEL_W >= 240
+    const AnnunDesc annunDesc[] PROGMEM = {
+      // status line
+      {ANN_F16, 0x02, 0,        yfirtsline,     K_STR, T_REM},
+      {ANN_F16, 0x20, 16,       yfirtsline,     K_STR, T_SRQ},
+      {ANN_F17, 0x02, 32,       yfirtsline,     K_STR, T_LSTN},
+      {ANN_F18, 0x20, 52,       yfirtsline,     K_STR, T_TLK},
+      {ANN_F18, 0x02, 68,       yfirtsline,     K_STR, T_ONLY},
+      // right hand symbols
+      {ANN_F2,  0x10, 172,      yfirtsline+10,  K_STR, T_2W},
+      {ANN_F1,  0x04, 180,      yfirtsline+10,  K_STR, T_4W},
+      {ANN_F2,  0x40, 180,      yfirtsline+20,  K_STR, T_HF},
+      // inverted annunciators
+      {ANN_F1,  0x01, 172,      yfirtsline,     K_INV, T_SHFT},
+      {ANN_F1,  0x20, 192,      yfirtsline,     K_INV, T_LIM},
+      {ANN_F0,  0x02, 208,      yfirtsline,     K_INV, T_DELTA},
+      {ANN_F1,  0x40, 192,      yfirtsline+10,  K_INV, T_CAL},
+      {ANN_F0,  0x01, 212,      yfirtsline+10,  K_INV, T_AXB},
+      {ANN_F1,  0x40, 192,      yfirtsline+20,  K_INV, T_MIN},
+      {ANN_F0,  0x04, 212,      yfirtsline+20,  K_INV, T_MAX},
+      {ANN_F1,  0x80, 192,      yfirtsline+30,  K_INV, T_READ},
+      {ANN_F0,  0x08, 212,      yfirtsline+30,  K_INV, T_BURST},
+      {ANN_F0,  0x10, 192,      yfirtsline+40,  K_INV, T_SEQU},
+      {ANN_F0,  0x20, 212,      yfirtsline+40,  K_INV, T_DELAY},
+      {ANN_F17, 0x10, 192,      yfirtsline+50,  K_INV, T_ZERO},
+      {ANN_F17, 0x20, 212,      yfirtsline+50,  K_INV, T_SET},
+      // right hand glyphs
+      {ANN_F1,  0x02, 160,      yfirtsline-6,   K_XBM, X_LSP},
+      {ANN_F2,  0x20, 160,      yfirtsline+4,   K_XBM, X_DIODE},
+      {ANN_F0,  0x40, 180,      yfirtsline+29,  K_XBM, X_AC},
+      {ANN_F0,  0x80, 180,      yfirtsline+36,  K_XBM, X_DC},
+      {ANN_F2,  0x80, 180,      yfirtsline+26,  K_XBM, X_DCAC},
+      {ANN_F2,  0x01, 172,      yfirtsline+18,  K_XBM, X_DNARROW},
+      {ANN_F2,  0x02, 172,      yfirtsline+13,  K_XBM, X_UPARROW},
+      {ANN_F2,  0x04, 168,      yfirtsline+26,  K_XBM, X_Z},
+      // zap, up arrow and bottom line
+      {ANN_F16, 0x01, 0,        yfirtsline+6,   K_XBM, X_ZAP},
+      {ANN_F16, 0x10, 18,       yfirtsline+6,   K_XBM, X_UPARROW2},
+      {ANN_F17, 0x01, 0,        yfirtsline+50,  K_STR, T_MRNG},
+      {ANN_F17, 0x04, 24,       yfirtsline+50,  K_STR, T_STRG},
+      {ANN_F17, 0x08, 45,       yfirtsline+44,  K_XBM, X_FCTARROW},
+      {ANN_F18, 0x80, 52,       yfirtsline+50,  K_STR, T_SPEED},
+      {ANN_F18, 0x40, 72,       yfirtsline+50,  K_STR, T_1},
+      {ANN_F18, 0x10, 76,       yfirtsline+50,  K_STR, T_2},
+      {ANN_F18, 0x01, 80,       yfirtsline+50,  K_STR, T_3},
+      {ANN_F18, 0x04, 84,       yfirtsline+50,  K_STR, T_4},
+      {ANN_F18, 0x08, 90,       yfirtsline+44,  K_XBM, X_FCTARROW},
+      {ANN_F19, 0x80, 97,       yfirtsline+50,  K_STR, T_FILT},
+      {ANN_F19, 0x40, 117,      yfirtsline+50,  K_STR, T_NULL},
+      {ANN_F19, 0x10, 133,      yfirtsline+44,  K_XBM, X_FCTARROW},
+      {ANN_F19, 0x01, 140,      yfirtsline+50,  K_STR, T_HOLD},
+      {ANN_F19, 0x04, 160,      yfirtsline+50,  K_STR, T_PROBE},
+      {ANN_F19, 0x08, 182,      yfirtsline+44,  K_XBM, X_FCTARROW},
+      {ANN_F19, 0x02, 146,      yfirtsline+6,   K_XBM, X_S}};
+#else
+    // 128 pixels : status line and bargraph on top, the readout below it with the glyphs on its right, then
+    // the inverted annunciators and the bottom line on 4 lines of text (baselines 39, 47, 55 and 63) with
+    // the mode symbols in the bottom right corner
+    const AnnunDesc annunDesc[] PROGMEM = {
+      // status line
+      {ANN_F16, 0x02, 0,        yfirtsline,     K_STR, T_REM},
+      {ANN_F16, 0x20, 14,       yfirtsline,     K_STR, T_SRQ},
+      {ANN_F17, 0x02, 28,       yfirtsline,     K_STR, T_LSTN},
+      {ANN_F18, 0x20, 46,       yfirtsline,     K_STR, T_TLK},
+      {ANN_F18, 0x02, 60,       yfirtsline,     K_STR, T_ONLY},
+      // right of the unit
+      {ANN_F16, 0x01, 115,      8,              K_XBM, X_ZAP},
+      {ANN_F16, 0x10, 115,      18,             K_XBM, X_UPARROW2},
+      {ANN_F19, 0x02, 122,      18,             K_XBM, X_S},
+      {ANN_F1,  0x02, 115,      25,             K_XBM, X_LSP},
+      // inverted annunciators and right hand symbols
+      {ANN_F1,  0x01, 2,        39,             K_INV, T_SHFT},
+      {ANN_F1,  0x20, 22,       39,             K_INV, T_LIM},
+      {ANN_F0,  0x02, 36,       39,             K_INV, T_DELTA},
+      {ANN_F1,  0x40, 62,       39,             K_INV, T_CAL},
+      {ANN_F0,  0x01, 76,       39,             K_INV, T_AXB},
+      {ANN_F2,  0x10, 94,       39,             K_STR, T_2W},
+      {ANN_F1,  0x04, 103,      39,             K_STR, T_4W},
+      {ANN_F1,  0x40, 2,        47,             K_INV, T_MIN},
+      {ANN_F0,  0x04, 16,       47,             K_INV, T_MAX},
+      {ANN_F1,  0x80, 30,       47,             K_INV, T_READ},
+      {ANN_F0,  0x08, 48,       47,             K_INV, T_BURST},
+      {ANN_F0,  0x10, 70,       47,             K_INV, T_SEQU},
+      {ANN_F0,  0x20, 88,       47,             K_INV, T_DELAY},
+      {ANN_F2,  0x20, 108,      41,             K_XBM, X_DIODE},
+      {ANN_F17, 0x10, 2,        55,             K_INV, T_ZERO},
+      {ANN_F17, 0x20, 20,       55,             K_INV, T_SET},
+      {ANN_F2,  0x40, 34,       55,             K_STR, T_HF},
+      // bottom line, split on two lines
+      {ANN_F19, 0x80, 44,       55,             K_STR, T_FILT},
+      {ANN_F19, 0x40, 62,       55,             K_STR, T_NULL},
+      {ANN_F19, 0x10, 79,       49,             K_XBM, X_FCTARROW},
+      {ANN_F19, 0x01, 86,       55,             K_STR, T_HOLD},
+      {ANN_F17, 0x01, 0,        63,             K_STR, T_MRNG},
+      {ANN_F17, 0x04, 21,       63,             K_STR, T_STRG},
+      {ANN_F17, 0x08, 41,       57,             K_XBM, X_FCTARROW},
+      {ANN_F18, 0x80, 47,       63,             K_STR, T_SPEED},
+      {ANN_F18, 0x40, 68,       63,             K_STR, T_1},
+      {ANN_F18, 0x10, 72,       63,             K_STR, T_2},
+      {ANN_F18, 0x01, 76,       63,             K_STR, T_3},
+      {ANN_F18, 0x04, 80,       63,             K_STR, T_4},
+      {ANN_F18, 0x08, 84,       57,             K_XBM, X_FCTARROW},
+      {ANN_F19, 0x04, 90,       63,             K_STR, T_PROBE},
+      {ANN_F19, 0x08, 110,      57,             K_XBM, X_FCTARROW},
+      // mode symbols
+      {ANN_F2,  0x02, 116,      33,             K_XBM, X_UPARROW},
+      {ANN_F2,  0x01, 122,      33,             K_XBM, X_DNARROW},
+      {ANN_F2,  0x80, 118,      37,             K_XBM, X_DCAC},
+      {ANN_F0,  0x40, 118,      40,             K_XBM, X_AC},
+      {ANN_F0,  0x80, 118,      47,             K_XBM, X_DC},
+      {ANN_F2,  0x04, 117,      53,             K_XBM, X_Z}};
+#endif
+    #define ANNUN_DESC_COUNT (sizeof(annunDesc)/sizeof(annunDesc[0]))
+
+    struct Box { int16_t x, y, w, h; };
+
+// ************************* bargraph ***********************
+// The 17 bargraph positions are spread over 3 bytes : the left end mark is frame[19] bit 5, the 15 dots and
+// the right end mark are frame[8] then frame[7], with their bits out of screen order. barMask() puts them in
+// one mask, bit n lighting position n from the left (BAR(n)). drawBar() draws the lit dots as filled runs,
+// one drawBox() per run instead of one character per dot, and markChanges() only marks the positions whose
+// bit flipped between two frames.
+
+    // bits of frame[8] (or frame[7]) in screen order : 0x02 0x01 0x04 0x08 0x80 0x40 0x10 0x20
+    constexpr uint8_t barOrder(uint8_t b) {
+      return (b & 0x0c) | (b & 0x01) << 1 | (b & 0x02) >> 1 | (b & 0x30) << 2 | (b & 0x40) >> 1 | (b & 0x80) >> 3;
+    }
+
+// ************************* trend ***********************
+// The SSD1322 layout leaves 22 columns free on the right of the inverted annunciators. With TREND they plot
+// the reading as a sparkline, one column per TREND_PERIOD ms. The columns are used as a ring, like the sweep
+// of a scope : sample k goes to column k % TREND_W and is followed by a blank column, so nothing scrolls and
+// a new sample only changes 3 columns : its own, the blank one and the one after, whose segment started from
+// the sample just blanked (the tiles under them with DIRTY_TILES). The vertical scale is the min
+// and max of the samples on screen, the whole plot is redrawn when a sample falls outside of it and when the
+// scale is fitted again at the start of each sweep. Another unit clears the plot.
+
+//#define TREND                        // trend of the reading in the free columns on the right, see trendSample()
+#define TREND_PERIOD 500               // ms between two samples
+
+#ifdef TREND
+  #if PANEL != PANEL_SSD1322_256X64
+    #error "TREND uses the free columns on the right of the SSD1322 layout"
+  #endif
+    #define TREND_X 234                // plot area, drawing coordinates
+    #define TREND_Y 0
+    #define TREND_W 22                 // one sample per column
+    #define TREND_H 64
+    #define TREND_NONE 0xff            // no point in this column
+
+    float    trendVal[TREND_W];        // samples in the unit, NAN for none (blank column, overload, cleared)
+    uint8_t  trendY[TREND_W];          // row of each sample, TREND_NONE for none
+    uint8_t  trendHead = TREND_W - 1;  // column of the newest sample
+    uint8_t  trendUnit = 0xff;         // UNIT_xx of the samples, 0xff before the first one
+    float    trendLo, trendHi;         // vertical scale, trendHi is drawn at TREND_Y
+    uint32_t trendLast;                // millis() of the newest sample
+#endif
+
+
+// ************************* dirty tiles ***********************
+// The display memory is seen by u8g2 as PANEL_TILES x 8 tiles of 8x8 pixels (32x8 on the SSD1322). Instead of running the page loop over
+// the whole screen, only the tiles covering what changed between two DisplayStates are redrawn and sent.
+// dirtyTiles[row] has one bit per tile column, in display memory coordinates.
+
+#define DIRTY_TILES                  // comment out to redraw the whole screen on every change
+
+#ifdef DIRTY_TILES
+    uint32_t dirtyTiles[8];
+#endif
+
+// ************************* SSD1322 direct writes ***********************
+// The SSD1322 holds 4 bits per pixel, u8g2 sends whole 8x8 tiles and expands each pixel to 0 or 15 on the
+// way. With SSD1322_DIRECT the cells of the main readout (digits, decimal points, sign, unit) are sent
+// through a write window cut to the cell instead : column address 0x15 (units of 4 pixels), row address
+// 0x75, write RAM 0x5C then the pixels, 2 per byte, left one in the high nibble. A digit cell becomes
+// 5 or 6 columns by 28 rows (about 170 bytes) instead of up to 20 tiles (640 bytes) with a window command
+// for each tile. The pixels still come from the u8g2 page buffer so the look doesn't change, u8g2 keeps
+// the full draws and the annunciators. The readout pixels are sent with the brightness READOUT_GRAY,
+// below 15 the readout is sent again after each full draw.
+
+//#define SSD1322_DIRECT               // send the readout cells through their own window
+#define READOUT_GRAY 15                // 1..15, brightness of the readout
+
+#ifdef SSD1322_DIRECT
+  #if PANEL != PANEL_SSD1322_256X64
+    #error "SSD1322_DIRECT writes the SSD1322 memory, it needs PANEL_SSD1322_256X64"
+  #endif
+  #ifndef DIRTY_TILES
+    #error "SSD1322_DIRECT is part of the dirty tiles redraw, enable DIRTY_TILES too"
+  #endif
+    #define DIRECT_MAX 16              // every cell of the readout : 7 digits, 7 points, sign, unit
+
+    struct DirectRect { uint8_t c0, c1, y0, y1; };  // display memory columns (4 pixels each) and rows
+    DirectRect directRect[DIRECT_MAX];
+    uint8_t directCount = 0;
+    uint8_t directRows = 0;            // tile rows touched by directRect[], one bit each
+#endif
+
+
+#ifdef I2C_RECORD
+// ************************* I2C capture ***********************
+// Every transaction received is written as one binary record to Serial (115200 bauds) :
+//
+//    0xA5  count  lost  t0 t1 t2 t3  byte[0] .. byte[count-1]
+//
+// count is the number of bytes of the transaction (commands included), lost the number of records dropped
+// just before this one because the host didn't keep up (255 max), t0..t3 the micros() of the reception,
+// little endian. A frame is about 45 bytes of capture every 30 ms. receiveEvent() only copies the record into
+// txRing[] and loop() moves it to the Serial buffer when there is room, so recording never blocks the TWI
+// interrupt nor the rendering. The count + bytes part of the records is the replayData[] format, and
+// tools/capture_replay.cpp replays a capture on a PC through the same PCF8576 emulation and decoder.
+
+#if defined(FRAME_STATS) || defined(FRAME_CRC) || defined(STAGE_PROFILE)
+  #error "I2C_RECORD uses Serial for binary data, FRAME_STATS, FRAME_CRC and STAGE_PROFILE can't be used with it"
+#endif
+
+#endif
+
+#ifdef TELEMETRY
+// ************************* telemetry ***********************
+// Every time the reading changes it is written as one 15 byte binary record to Serial (115200 bauds) :
+//
+//    0x5A  lost  t0 t1 t2 t3  v0 v1 v2 v3  exp  unit  prefix  flags  sum
+//
+// the reading is v * 10^exp in the unit, v a signed 32 bit integer, exp a signed byte including the prefix
+// ("-1.23450 mV" is v = -123450, exp = -8), the Reading of PM2525_decode.h : unit and prefix are the UNIT_xx
+// and PFX_xx codes, flags the RDG_xx bits. lost is the number of records dropped just before this one because the host didn't keep up
+// (255 max), t0..t3 the micros() of the decode, multi byte fields are little endian and sum is the 8 bit sum
+// of all the bytes before it. Records only go into txRing[], loop() moves them to the Serial buffer when there
+// is room so the rendering never waits for the host. tools/telemetry_log.py turns the stream into CSV.
+
+#if defined(I2C_RECORD) || defined(FRAME_STATS) || defined(FRAME_CRC) || defined(STAGE_PROFILE)
+  #error "TELEMETRY uses Serial for binary data, I2C_RECORD, FRAME_STATS, FRAME_CRC and STAGE_PROFILE can't be used with it"
+#endif
+
+    #define TLM_RECORD_SIZE 15
+    // v .. flags of the last record queued, a record is only sent when they change. No reading has flags 0xff
+    // so the first one always goes out
+    uint8_t lastReading[TLM_RECORD_SIZE - 7] = {0, 0, 0, 0, 0, 0, 0, 0xff};
+#endif
+
+#if defined(I2C_RECORD) || defined(TELEMETRY)
+    #define TX_RING_SIZE 128              // power of 2, at least one 22 byte transaction + header
+    uint8_t txRing[TX_RING_SIZE];
+    volatile uint8_t txHead = 0;          // written by the producer
+    volatile uint8_t txTail = 0;          // written by txFlush()
+    uint8_t recordsLost = 0;
+#endif
+
+#ifdef FRAME_REPLAY
+// ************************* frame replay ***********************
+// recorded I2C transactions, each one is its byte count followed by the bytes as the PCF8576 gets them
+// (5 command bytes then the display data). Two transactions make a frame, the table ends with a 0 count.
+// The frames below count the last digit of " 1.23450 mV DC" up with a growing bargraph, one of them negative.
+// Replace them with a capture of your own to reproduce what the meter sends.
+
+    const uint8_t replayData[] PROGMEM = {
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x00, 0x0f, 0xf6, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x00, 0x8f, 0x50, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x00, 0xcf, 0xb5, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x00, 0xdf, 0xf1, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x00, 0xff, 0x53, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x02, 0xff, 0xe3, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x40, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x03, 0xff, 0xe7, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      22, 0xc8, 0xe0, 0xf8, 0xf0, 0x06, 0x01, 0x45, 0x44, 0x94, 0x07, 0xff, 0x70, 0xe3, 0x53, 0xf1, 0xbd, 0x50, 0x00, 0x04, 0x00, 0x00, 0x20,
+       8, 0xc8, 0xe0, 0xf8, 0xf0, 0x00, 0x80, 0x00, 0x00,
+      0};
+
+    // stands in for Wire in receiveEvent(), reads one transaction of replayData[]
+    struct ReplayBus {
+      const uint8_t *p;
+      uint8_t left;
+      int available() { return left; }
+      int read() { left--; return pgm_read_byte(p++); }
+    };
+    ReplayBus replayBus;
+    const uint8_t *replayPos = replayData;
+#endif
+
+// u8g2 buffer : BUFFER_TILE_ROWS rows of 8 pixels, PANEL_W bytes each, drawn and sent once per frame for 8
+// (the whole screen, 2 KB on the SSD1322, too much for the Nano) or page by page for the others. 1 is the only
+// one leaving room on a Nano with the SSD1322, bigger buffers mean fewer passes over drawState() on boards
+// with more SRAM or with a 128 pixel wide panel.
+#define BUFFER_TILE_ROWS 1             // 1, 2 or 8
+
+// construtor usage PANEL_U8G2(1)(rotation, cs, dc [, reset]) [page buffer, size = PANEL_W bytes]
+#if BUFFER_TILE_ROWS == 1
+    PANEL_U8G2(1) u8g2(U8G2_R2, 5, 3, 4); // OLED init
+#elif BUFFER_TILE_ROWS == 2
+    PANEL_U8G2(2) u8g2(U8G2_R2, 5, 3, 4); // 2 * PANEL_W bytes, 4 pages
+#elif BUFFER_TILE_ROWS == 8
+  #if defined(__AVR_ATmega328P__) && PANEL_W > 128
+    #error "the full frame buffer needs PANEL_W * 8 bytes of SRAM, use BUFFER_TILE_ROWS 1 or 2 on the Nano"
+  #endif
+    PANEL_U8G2(F) u8g2(U8G2_R2, 5, 3, 4); // PANEL_W * 8 bytes, the whole screen
+#else
+  #error "BUFFER_TILE_ROWS is 1, 2 or 8"
+#endif
 
 
 void setup(void) {
+#if PANEL == PANEL_SSD1322_256X64 || PANEL == PANEL_SSD1306_128X64
+ u8g2.setBusClock(10000000);      // SSD1322 and SSD1306 serial clock limit, the AVR SPI gives the closest lower one (F_CPU/2)
+#endif                            // the other panels keep the clock of their u8g2 driver
  u8g2.begin();
+ u8g2.setFontMode(1);             // transparent text, was set by the first DrawInvStr()
 //Serial.begin(9600);           // start serial interface for debugging purposes only .comment out in real life 
-  
+#if defined(FRAME_STATS) || defined(FRAME_CRC) || defined(STAGE_PROFILE) || defined(RENDER_BENCH) || defined(CYCLE_BENCH) || defined(RX_CYCLES)
+  Serial.begin(115200);
+#endif
+#ifdef RENDER_BENCH
+  renderBench();
+#endif
+#ifdef CYCLE_BENCH
+  cycleBench();
+#endif
+
+#if defined(I2C_RECORD) || defined(TELEMETRY)
+  Serial.begin(115200);
+#endif
+
+#ifndef FRAME_REPLAY
+#ifdef TWI_DIRECT
+  twiBegin(0x38);
+#else
   Wire.begin(0x38);                // i2c bus slave address #38 (defaut address of the PCF 8576) A4 is SDA A5 is SCL
   Wire.onReceive(receiveEvent); // register event
+#endif
+#endif
+#ifdef RX_CYCLES
+  rxMeasure();
+#endif
+#ifdef DUAL_CORE
+  displayReady.store(true, std::memory_order_release);
+#endif
  
 }
+// decodes and renders the newest complete frame (renders it on core 1 with DUAL_CORE), older ones are simply skipped
 void loop(void){
-  
+  int8_t slot;
+#ifdef DUAL_CORE
+  DisplayState &next = stateBox.back();      // decoded straight into the slot handed over to core 1
+#else
+  DisplayState next;
+#endif
+  PROF(uint32_t tDecode;)
+
+#ifdef FRAME_REPLAY
+  replayFrame();
+#endif
+
+  noInterrupts();                  // receiveEvent() must not publish while we take the copy
+  slot = readySlot;
+  if (slot >= 0)
+  {
+    memcpy(frame, (const uint8_t *)frameSlot[slot], sizeof(frame));
+    readySlot = -1;
+  }
+  interrupts();
+
+  if (slot >= 0)
+  {
+    PROF(tDecode = PROF_NOW();)
+    decodeFrame(frame, &next);
+    PROF(stageAdd(STAGE_DECODE, PROF_NOW() - tDecode);)
+#ifdef TELEMETRY
+    telemetrySend(&next);
+#endif
+#ifdef DUAL_CORE
+    stateBox.publish();                  // drawn by loop1()
+#else
+    renderState(&next);
+#endif
+  }
+
+#if defined(PCF_BLINK) && !defined(DUAL_CORE)
+  blinkUpdate();
+#endif
+#ifdef FRAME_STATS
+  printFrameStats();
+#endif
+#ifdef STAGE_PROFILE
+  printProfile();
+#endif
+#if defined(I2C_RECORD) || defined(TELEMETRY)
+  txFlush();
+#endif
 }
-// the host drops a data frame every 30ms triggering an event . the received data are stored in frame[] in the right order
-// then decoded to be displayed
+
+// draws next when it differs from what is on screen, or when the trend moved
+void renderState(const DisplayState *next) {
+  bool redraw = false;
+  STAT(uint32_t t;)
+
+#ifdef TREND
+  redraw = trendSample(next);            // the plot moves on even when the readout doesn't change
+#endif
+  if (redraw || !shownValid || memcmp(next, &shown, sizeof(DisplayState)) != 0)
+  {
+    STAT(t = micros();)
+#ifdef DIRTY_TILES
+    if (shownValid)
+    {
+      markChanges(&shown, next);
+      transcodeDirty(next);
+    }
+    else
+#endif
+    {
+      transcode(next);
+#ifdef SSD1322_DIRECT
+      if (READOUT_GRAY != 15)            // u8g2 sent the readout at full brightness
+      {
+        markReadout();
+        transcodeDirty(next);
+      }
+#endif
+    }
+    STAT(t = micros() - t;)
+    STAT(renderMicros += t;)
+    STAT(if (t > renderMicrosMax) renderMicrosMax = t;)
+    shown = *next;
+    shownValid = true;
+    framesRendered++;
+#ifdef FRAME_CRC
+    printScreenCrc(next);
+#endif
+  }
+  else framesUnchanged++;
+}
+
+#ifdef DUAL_CORE
+// core 1 : draws the newest state decoded by loop() on core 0
+void setup1() {
+}
+
+void loop1() {
+  if (!displayReady.load(std::memory_order_acquire)) return;   // setup() is still starting the display
+  if (stateBox.take()) renderState(&stateBox.front());
+#ifdef PCF_BLINK
+  blinkUpdate();
+#endif
+}
+#endif
+
+#ifdef FRAME_STATS
+// received / rendered / unchanged / dropped since boot, at 30 ms per frame received should grow by about 33 each second.
+// followed by the render cost per frame drawn during the last second : mean and max time, draw calls and SPI bytes
+void printFrameStats() {
+  static uint32_t lastPrint = 0;
+  static uint32_t lastRendered = 0, lastCalls = 0, lastBytes = 0, lastMicros = 0;
+  uint32_t received, dropped, n;
+
+  if (millis() - lastPrint < 1000) return;
+  lastPrint = millis();
+
+  noInterrupts();                  // 32 bit counters are updated from the TWI interrupt
+  received = framesReceived;
+  dropped = framesDropped;
+  interrupts();
+
+  Serial.print(F("rx "));   Serial.print(received);
+  Serial.print(F(" draw ")); Serial.print(framesRendered);
+  Serial.print(F(" same ")); Serial.print(framesUnchanged);
+  Serial.print(F(" drop ")); Serial.print(dropped);
+
+  n = framesRendered - lastRendered;
+  if (n)
+  {
+    Serial.print(F(" | us ")); Serial.print((renderMicros - lastMicros) / n);
+    Serial.print(F(" max ")); Serial.print(renderMicrosMax);
+    Serial.print(F(" calls ")); Serial.print((drawCalls - lastCalls) / n);
+    Serial.print(F(" spi ")); Serial.print((spiBytes - lastBytes) / n);
+  }
+  Serial.println();
+
+  lastRendered = framesRendered;
+  lastCalls = drawCalls;
+  lastBytes = spiBytes;
+  lastMicros = renderMicros;
+  renderMicrosMax = 0;
+}
+#endif
+
+#ifdef STAGE_PROFILE
+// adds one measure to a stage, called with interrupts disabled for STAGE_RX
+void stageAdd(uint8_t stage, uint32_t us) {
+  StageStats *s = &stages[stage];
+  uint16_t t = us > 0xffff ? 0xffff : us;
+  uint8_t  b = 0;
+
+  if (s->n == 0 || t < s->min) s->min = t;
+  if (t > s->max) s->max = t;
+  s->sum += t;
+  s->n++;
+  while (t >>= 1) b++;
+  if (s->hist[b] != 0xffff) s->hist[b]++;
+}
+
+// one line per stage :  name n <count> min <us> mean <us> max <us> | <bucket 0> .. <bucket 15>
+// a stage with nothing measured during the window only prints its name and n 0
+void printProfile() {
+  static uint32_t lastPrint = 0;
+  StageStats s;
+  uint8_t i, b;
+
+  if (Serial.available())                  // report on demand
+    while (Serial.available()) Serial.read();
+  else if (PROFILE_PERIOD == 0 || millis() - lastPrint < PROFILE_PERIOD) return;
+  lastPrint = millis();
+
+  Serial.println(F("stage profile, us, histogram buckets 2^b us"));
+  for ( i=0; i<STAGE_COUNT ; i++){
+    noInterrupts();                        // STAGE_RX is updated by the TWI interrupt
+    s = stages[i];
+    memset(&stages[i], 0, sizeof(StageStats));
+    interrupts();
+
+    Serial.print((const __FlashStringHelper *)stageName[i]);
+    Serial.print(F(" n ")); Serial.print(s.n);
+    if (s.n)
+    {
+      Serial.print(F(" min ")); Serial.print(s.min);
+      Serial.print(F(" mean ")); Serial.print(s.sum / s.n);
+      Serial.print(F(" max ")); Serial.print(s.max);
+      Serial.print(F(" |"));
+      for ( b=0; b<STAGE_BUCKETS ; b++){
+        Serial.print(' ');
+        Serial.print(s.hist[b]);
+      }
+    }
+    Serial.println();
+  }
+}
+#endif
+
+#ifdef RX_CYCLES
+// the cycles taken by the TWI interrupt per frame received during RX_WINDOW, see the RX_CYCLES comment
+void rxMeasure() {
+  uint16_t t0, t1, gap, gapMin = 0xffff, gapMax = 0;
+  uint32_t elapsed = 0, reads = 0, frames;
+
+  Serial.flush();                      // no Serial interrupt during the window
+  TCCR1A = 0;                          // Timer1 free running at clk/1
+  TCCR1B = _BV(CS10);
+  TIMSK0 &= ~_BV(TOIE0);               // no millis() interrupt either
+  noInterrupts();
+  frames = framesReceived;
+  interrupts();
+
+  t0 = TCNT1;
+  while (elapsed < (uint32_t)RX_WINDOW << 16)
+  {
+    t1 = TCNT1;
+    gap = t1 - t0;
+    t0 = t1;
+    elapsed += gap;
+    reads++;
+    if (gap < gapMin) gapMin = gap;
+    if (gap > gapMax) gapMax = gap;
+  }
+
+  noInterrupts();
+  frames = framesReceived - frames;
+  interrupts();
+  TIMSK0 |= _BV(TOIE0);
+
+#ifdef TWI_DIRECT
+  Serial.print(F("rx twi_direct cycles/frame "));
+#else
+  Serial.print(F("rx wire cycles/frame "));
+#endif
+  Serial.print(frames ? (elapsed - reads * gapMin) / frames : 0);
+  Serial.print(F(" longest ")); Serial.print(gapMax - gapMin);
+  Serial.print(F(" frames ")); Serial.println(frames);
+}
+#endif
+
+#if defined(I2C_RECORD) || defined(TELEMETRY)
+// room left in txRing[]
+uint8_t txFree() {
+  return TX_RING_SIZE - 1 - (uint8_t)((txHead - txTail) & (TX_RING_SIZE - 1));
+}
+
+// adds a byte to txRing[], the caller checked there is room with txFree()
+void txPut(uint8_t b) {
+  txRing[txHead] = b;
+  txHead = (txHead + 1) & (TX_RING_SIZE - 1);
+}
+
+// moves what fits in the Serial transmit buffer without waiting
+void txFlush() {
+  int room = Serial.availableForWrite();
+
+  while (room-- > 0 && txTail != txHead)
+  {
+    Serial.write(txRing[txTail]);
+    txTail = (txTail + 1) & (TX_RING_SIZE - 1);
+  }
+}
+#endif
+
+#ifdef I2C_RECORD
+// header of a capture record, returns false when the record doesn't fit and is dropped
+bool recordStart(uint8_t count) {
+  uint32_t t = micros();
+
+  if (txFree() < count + 7)
+  {
+    if (recordsLost < 255) recordsLost++;
+    return false;
+  }
+  txPut(0xA5);
+  txPut(count);
+  txPut(recordsLost);
+  txPut(t);
+  txPut(t >> 8);
+  txPut(t >> 16);
+  txPut(t >> 24);
+  recordsLost = 0;
+  return true;
+}
+#endif
+
+#ifdef TELEMETRY
+// queues a record for ds when its reading differs from the last one queued. A record that doesn't fit in
+// txRing[] is dropped and counted, the same reading is tried again with the next frame
+void telemetrySend(const DisplayState *ds) {
+  uint8_t  rec[TLM_RECORD_SIZE];
+  uint32_t t = micros();
+  Reading  r;
+  uint8_t  i, sum;
+
+  readingOf(ds, &r);
+  rec[6]  = r.value;
+  rec[7]  = r.value >> 8;
+  rec[8]  = r.value >> 16;
+  rec[9]  = r.value >> 24;
+  rec[10] = r.exp;
+  rec[11] = r.unit;
+  rec[12] = r.prefix;
+  rec[13] = r.flags;
+  if (memcmp(rec + 6, lastReading, sizeof(lastReading)) == 0) return;
+
+  if (txFree() < TLM_RECORD_SIZE)
+  {
+    if (recordsLost < 255) recordsLost++;
+    return;
+  }
+  rec[0] = 0x5A;
+  rec[1] = recordsLost;
+  rec[2] = t;
+  rec[3] = t >> 8;
+  rec[4] = t >> 16;
+  rec[5] = t >> 24;
+  sum = 0;
+  for ( i=0; i<TLM_RECORD_SIZE-1 ; i++){
+    sum += rec[i];
+    txPut(rec[i]);
+  }
+  txPut(sum);
+  memcpy(lastReading, rec + 6, sizeof(lastReading));
+  recordsLost = 0;
+}
+#endif
+
+#ifdef FRAME_REPLAY
+// feeds the next frame of replayData[] through receiveEvent(), as the TWI interrupt would
+void replayFrame() {
+  uint8_t n;
+#if REPLAY_PERIOD
+  static uint32_t lastFrame = 0;
+
+  if (millis() - lastFrame < REPLAY_PERIOD) return;
+  lastFrame = millis();
+#endif
+
+  for ( n=0; n<2 ; n++){
+    noInterrupts();
+    replayTransaction();
+    interrupts();
+  }
+}
+
+// the next transaction of replayData[] through receiveEvent(), with the interrupts off
+void replayTransaction() {
+  replayBus.left = pgm_read_byte(replayPos);
+  if (replayBus.left == 0)                   // end of the recording, start over
+  {
+    replayPos = replayData;
+    replayBus.left = pgm_read_byte(replayPos);
+  }
+  replayBus.p = replayPos + 1;
+  replayPos += replayBus.left + 1;
+  receiveEvent(replayBus.left);
+}
+#endif
+
+#if (defined(RENDER_BENCH) || defined(CYCLE_BENCH)) && defined(__AVR__)
+// ************************* stack painting ***********************
+    extern uint8_t __heap_start, *__brkval;
+    #define STACK_PAINT 0xa5
+
+// fills the free SRAM between the heap and the current stack frame with STACK_PAINT
+void stackPaint() {
+  uint8_t *p = __brkval ? __brkval : &__heap_start;
+  uint8_t *sp = (uint8_t *)SP;
+
+  while (p < sp - 16) *p++ = STACK_PAINT;   // stay clear of this function's own frame
+}
+
+// lowest byte of the stack written since stackPaint()
+uint8_t *stackLow() {
+  uint8_t *p = __brkval ? __brkval : &__heap_start;
+
+  while (p <= (uint8_t *)RAMEND && *p == STACK_PAINT) p++;
+  return p;
+}
+
+// bytes of SRAM used so far : everything below the heap end plus the stack down to the lowest byte written
+uint16_t sramPeak() {
+  return (uint16_t)(__brkval ? __brkval : &__heap_start) - RAMSTART + (RAMEND + 1 - (uint16_t)stackLow());
+}
+#endif
+
+#ifdef RENDER_BENCH
+// ************************* render benchmark ***********************
+// Run once from setup() before the I2C bus is started : BENCH_FRAMES full draws of a busy screen, then as
+// many dirty tile redraws with the last digit changing every frame like on a live reading. Prints the frame
+// rate, the SPI bytes per frame and the SRAM used : static data plus the deepest stack seen during the
+// benchmark, measured by filling the free SRAM with a pattern first (AVR only). Run it with each
+// BUFFER_TILE_ROWS on each board to pick the buffer size.
+
+#define BENCH_FRAMES 50
+
+// one benchmark run : frames per second and SPI bytes per frame
+void benchPrint(const __FlashStringHelper *name, uint32_t t, uint32_t bytes) {
+  Serial.print(name);
+  Serial.print(F(" fps ")); Serial.print(BENCH_FRAMES * 1000000UL / t);
+  Serial.print(F(" us ")); Serial.print(t / BENCH_FRAMES);
+  Serial.print(F(" spi ")); Serial.println(bytes / BENCH_FRAMES);
+}
+
+void renderBench() {
+  DisplayState a, b;
+  uint32_t t, bytes;
+  uint8_t  i;
+
+  memset(&a, 0, sizeof(a));
+  memset(a.annun, 0x55, sizeof(a.annun));  // about half of the annunciators
+  memcpy(a.digits, " 123450", 7);
+  a.dp = 1 << 2;
+  a.polarity = POL_MINUS;
+  a.prefix = PFX_MILLI;
+  a.unit = UNIT_V;
+  b = a;
+  b.digits[6] = '9';
+
+#ifdef __AVR__
+  stackPaint();
+#endif
+  Serial.print(F("bench ")); Serial.print(F_CPU / 1000000UL);
+  Serial.print(F(" MHz, buffer ")); Serial.print(BUFFER_TILE_ROWS * PANEL_W);
+  Serial.println(F(" bytes"));
+
+  bytes = spiBytes;
+  t = micros();
+  for ( i=0; i<BENCH_FRAMES ; i++)
+    transcode(i & 1 ? &b : &a);
+  benchPrint(F("full "), micros() - t, spiBytes - bytes);
+
+#ifdef DIRTY_TILES
+  bytes = spiBytes;
+  t = micros();
+  for ( i=0; i<BENCH_FRAMES ; i++){
+    if (i & 1) { markChanges(&a, &b); transcodeDirty(&b); }
+    else       { markChanges(&b, &a); transcodeDirty(&a); }
+  }
+  benchPrint(F("dirty"), micros() - t, spiBytes - bytes);
+#endif
+
+#ifdef __AVR__
+  Serial.print(F("sram static ")); Serial.print((uint16_t)&__heap_start - RAMSTART);
+  Serial.print(F(" peak ")); Serial.print(sramPeak());
+  Serial.print(F(" of ")); Serial.println(RAMEND + 1 - RAMSTART);
+#endif
+  spiBytes = 0;
+}
+#endif
+
+#ifdef CYCLE_BENCH
+// ************************* cycle benchmark ***********************
+// Run once from setup() instead of waiting for the meter : the frames of replayData[] go through loop() back
+// to back, their 22 and 8 byte transactions through receiveEvent() as Wire delivers them, and the PROF()
+// hooks count the CPU cycles of each stage with Timer1 at clk/1 (extended to 32 bits by its overflows). The
+// millis() interrupt is stopped meanwhile so the counts only depend on the code and the frames : the same
+// build gives the same numbers on every Nano, and under simavr as nothing of the TWI hardware is used :
+// tools/bench_sim.py builds it, runs it there and checks the report unattended. The report is one key=value line per item, tools/bench_check.py compares it with a saved one :
+//   bench  mhz=16 panel=256 buffer=256 frames=64
+//   stage  name=rx n=128 min=.. mean=.. max=..     cycles per call, same for decode, draw and flush
+//   frame  spi=.. spi_est=.. draws=..                SPI bytes and u8g2 draw calls per frame
+//   sram   static=.. peak=.. rx_stack=.. worst=.. size=2048
+// spi is counted at the byte callback of u8x8, commands included, spi_est is the spiBytes estimate (pixel
+// data only) that FRAME_STATS and RENDER_BENCH print. peak is the static data plus the deepest stack of the
+// whole run. rx_stack is the stack taken by one replayed frame received in an interrupt : INT0 is triggered
+// from software by toggling D2 (unused, set as an output meanwhile) and its handler feeds the transactions
+// to receiveEvent() as Wire's interrupt would, the call levels inside Wire not included. worst = peak +
+// rx_stack for a frame arriving when loop() is at its deepest.
+
+#define CYCLE_FRAMES 64                // frames measured, after one full redraw
+
+#ifndef __AVR__
+  #error "CYCLE_BENCH counts with Timer1 and the AVR stack pointer, it only builds for AVR boards"
+#endif
+#if !defined(FRAME_REPLAY) || REPLAY_PERIOD != 0
+  #error "CYCLE_BENCH replays the frames back to back, enable FRAME_REPLAY with REPLAY_PERIOD 0"
+#endif
+
+    struct BenchStats { uint32_t n, sum, min, max; };   // cycles
+    BenchStats bench[STAGE_COUNT];
+    volatile uint16_t benchOverflows;  // Timer1 overflows, high word of benchCycles()
+    uint32_t benchSpi;                 // bytes sent to the display
+    u8x8_msg_cb benchByteCb;           // byte callback of the display, benchSpiByte() is put in front of it
+
+ISR(TIMER1_OVF_vect) {
+  benchOverflows++;
+}
+
+// one replayed frame from an interrupt, to measure the stack of the receive path
+ISR(INT0_vect) {
+  replayTransaction();
+  replayTransaction();
+}
+
+// counts the bytes going to the display, then hands them to the SPI
+uint8_t benchSpiByte(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+  if (msg == U8X8_MSG_BYTE_SEND) benchSpi += arg_int;
+  return benchByteCb(u8x8, msg, arg_int, arg_ptr);
+}
+
+// CPU cycles since Timer1 was started, also correct with the interrupts off for less than 65536 cycles
+uint32_t benchCycles() {
+  uint8_t  sreg = SREG;
+  uint16_t lo, hi;
+
+  cli();
+  lo = TCNT1;
+  hi = benchOverflows;
+  if ((TIFR1 & _BV(TOV1)) && lo < 0x8000) hi++;       // overflow not serviced yet
+  SREG = sreg;
+  return (uint32_t)hi << 16 | lo;
+}
+
+// called by the PROF() hooks in place of the STAGE_PROFILE one
+void stageAdd(uint8_t stage, uint32_t cycles) {
+  BenchStats *s = &bench[stage];
+
+  if (s->n == 0 || cycles < s->min) s->min = cycles;
+  if (cycles > s->max) s->max = cycles;
+  s->sum += cycles;
+  s->n++;
+}
+
+void cycleBench() {
+  uint8_t  i, *sp;
+  uint16_t rxStack, peak;
+
+  TCCR1A = 0;                          // Timer1 free running at clk/1
+  TCCR1B = _BV(CS10);
+  TIMSK1 |= _BV(TOIE1);
+  TIMSK0 &= ~_BV(TOIE0);               // no millis() interrupt in the measures
+
+  EICRA = (EICRA & ~(_BV(ISC01) | _BV(ISC00))) | _BV(ISC00);   // INT0 on any change of D2
+  EIFR = _BV(INTF0);
+  EIMSK |= _BV(INT0);
+  pinMode(2, OUTPUT);
+  stackPaint();                        // stack of one frame received on its own
+  sp = (uint8_t *)SP;
+  PIND = _BV(PIND2);                   // toggles D2, INT0 runs right after
+  rxStack = sp - stackLow();
+  EIMSK &= ~_BV(INT0);
+  pinMode(2, INPUT);
+  readySlot = -1;
+
+  benchByteCb = u8g2.getU8x8()->byte_cb;
+  u8g2.getU8x8()->byte_cb = benchSpiByte;
+  loop();                              // first frame, whole screen redrawn
+  memset(bench, 0, sizeof(bench));
+  spiBytes = 0;
+  benchSpi = 0;
+  drawCalls = 0;
+  stackPaint();
+  for ( i=0; i<CYCLE_FRAMES ; i++)
+    loop();
+  peak = sramPeak();
+  u8g2.getU8x8()->byte_cb = benchByteCb;
+
+  TIMSK0 |= _BV(TOIE0);
+  TIMSK1 &= ~_BV(TOIE1);
+
+  Serial.print(F("bench mhz=")); Serial.print(F_CPU / 1000000UL);
+  Serial.print(F(" panel=")); Serial.print(PANEL_W);
+  Serial.print(F(" buffer=")); Serial.print(BUFFER_TILE_ROWS * PANEL_W);
+  Serial.print(F(" frames=")); Serial.println(CYCLE_FRAMES);
+  for ( i=0; i<STAGE_COUNT ; i++){
+    Serial.print(F("stage name=")); Serial.print((const __FlashStringHelper *)stageName[i]);
+    Serial.print(F(" n=")); Serial.print(bench[i].n);
+    Serial.print(F(" min=")); Serial.print(bench[i].min);
+    Serial.print(F(" mean=")); Serial.print(bench[i].n ? bench[i].sum / bench[i].n : 0);
+    Serial.print(F(" max=")); Serial.println(bench[i].max);
+  }
+  Serial.print(F("frame spi=")); Serial.print(benchSpi / CYCLE_FRAMES);
+  Serial.print(F(" spi_est=")); Serial.print(spiBytes / CYCLE_FRAMES);
+  Serial.print(F(" draws=")); Serial.println(drawCalls / CYCLE_FRAMES);
+  Serial.print(F("sram static=")); Serial.print((uint16_t)&__heap_start - RAMSTART);
+  Serial.print(F(" peak=")); Serial.print(peak);
+  Serial.print(F(" rx_stack=")); Serial.print(rxStack);
+  Serial.print(F(" worst=")); Serial.print(peak + rxStack);
+  Serial.print(F(" size=")); Serial.println(RAMEND + 1 - RAMSTART);
+  spiBytes = 0;
+  drawCalls = 0;
+}
+#endif
+
+#ifdef FRAME_CRC
+// CRC16 (CCITT) of the whole screen content for ds, drawn tile row by tile row in the u8g2 buffer without
+// sending anything. Replayed frames give the same list of CRCs on every run, so a rendering change shows up
+// by comparing the Serial output with the one of a known good build.
+void printScreenCrc(const DisplayState *ds) {
+  static uint32_t n = 0;
+  uint16_t crc = 0xffff;
+  uint16_t k;
+  uint8_t  ty, b;
+  uint8_t  *buf = u8g2.getBufferPtr();
+  STAT(uint32_t calls = drawCalls;)
+
+  for ( ty=0; ty<8 ; ty+=BUFFER_TILE_ROWS){
+    u8g2.setBufferCurrTileRow(ty);
+    u8g2.clearBuffer();
+    drawState(ds);
+    for ( k=0; k<PANEL_W*BUFFER_TILE_ROWS ; k++){
+      crc ^= (uint16_t)buf[k] << 8;
+      for ( b=0; b<8 ; b++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  STAT(drawCalls = calls;)                   // not part of the render cost
+
+  Serial.print(F("crc "));
+  Serial.print(n++);
+  Serial.print(' ');
+  Serial.println(crc, HEX);
+}
+#endif
+
+// draws a decoded frame on the whole screen with the page loop. used for the first frame, and for every
+// change when DIRTY_TILES is off
 // 
-void transcode() {               // the host drops a data frame every 30ms. the received data are stored in frame[] in the right order
-  
-    int yfirtsline = 13;
-    char StrDisp[10];
-    uint8_t  i, j;  /* index des tableaux sur 8 bit aulieu de 16, on est sur un MCU 8 bit, les calculs en 16, c'est en gros 2 calculs de 8 */
-    uint16_t  lvalintU16; /* la valeur est en non signé, sur certains MCU, on a un petit gain */
-    uint8_t  frame0, frame1,  frame2, frame7, frame8, frame9, frame10, frame11, frame12, frame13, frame14, frame16, frame17, frame18, frame19; 
-      
+void transcode(const DisplayState *ds) {
+#if BUFFER_TILE_ROWS != 8
+  uint8_t more;
+#endif
+  PROF(uint32_t t, draw = 0, flush = 0;)
+
+#if BUFFER_TILE_ROWS == 8
+  PROF(t = PROF_NOW();)
+  u8g2.clearBuffer();
+  drawState(ds);
+  PROF(draw = PROF_NOW() - t; t = PROF_NOW();)
+  u8g2.sendBuffer();
+  STAT(spiBytes += 8*PANEL_TILES*TILE_BYTES;)
+  PROF(flush = PROF_NOW() - t;)
+#else
   u8g2.firstPage();
   do {
+    PROF(t = PROF_NOW();)
+    drawState(ds);
+    STAT(spiBytes += BUFFER_TILE_ROWS*PANEL_TILES*TILE_BYTES;)
+    PROF(draw += PROF_NOW() - t; t = PROF_NOW();)
+    more = u8g2.nextPage();                  // sends the page
+    PROF(flush += PROF_NOW() - t;)
+  } while ( more );
+#endif
+  PROF(stageAdd(STAGE_DRAW, draw); stageAdd(STAGE_FLUSH, flush);)
+}
+
+#ifdef DIRTY_TILES
+// redraws only the tiles marked by markChanges(). The tile rows held by the u8g2 buffer are drawn once when
+// one of them has a dirty tile, then only the dirty tiles are sent to the display
+//
+void transcodeDirty(const DisplayState *ds) {
+  uint8_t  tx, ty, row, cnt;
+#ifdef SSD1322_DIRECT
+  uint8_t  i;
+#endif
+  uint32_t mask;
+  uint8_t  *buf;
+  PROF(uint32_t t, draw = 0, flush = 0;)
+
+  for ( row=0; row<8 ; row+=BUFFER_TILE_ROWS){
+    mask = 0;
+    for ( ty=row; ty<row+BUFFER_TILE_ROWS ; ty++) mask |= dirtyTiles[ty];
+#ifdef SSD1322_DIRECT
+    if (!mask && !(directRows & (((1 << BUFFER_TILE_ROWS) - 1) << row))) continue;
+#else
+    if (!mask) continue;
+#endif
+
+    PROF(t = PROF_NOW();)
+    u8g2.setBufferCurrTileRow(row);
+    u8g2.clearBuffer();
+    drawState(ds);                       // u8g2 clips everything outside of these tile rows
+    PROF(draw += PROF_NOW() - t; t = PROF_NOW();)
+
+    buf = u8g2.getBufferPtr();
+    for ( ty=row; ty<row+BUFFER_TILE_ROWS ; ty++, buf+=PANEL_W){
+      mask = dirtyTiles[ty];
+      dirtyTiles[ty] = 0;
+      tx = 0;
+      while (mask)                       // one transfer per run of consecutive dirty tiles
+      {
+        while (!(mask & 1)) { mask >>= 1; tx++; }
+        cnt = 0;
+        while (mask & 1) { mask >>= 1; cnt++; }
+        u8x8_DrawTile(u8g2.getU8x8(), tx, ty, cnt, buf + tx*8);
+        STAT(spiBytes += cnt*TILE_BYTES;)
+        tx += cnt;
+      }
+#ifdef SSD1322_DIRECT
+      for ( i=0; i<directCount ; i++)
+        sendDirect(&directRect[i], ty);
+#endif
+    }
+    PROF(flush += PROF_NOW() - t;)
+  }
+#ifdef SSD1322_DIRECT
+  directCount = 0;
+  directRows = 0;
+#endif
+  PROF(stageAdd(STAGE_DRAW, draw); stageAdd(STAGE_FLUSH, flush);)
+}
+
+// marks the tiles covering a screen rectangle (in drawing coordinates) as dirty. the display is used upside
+// down (U8G2_R2) so the rectangle is mirrored to find the tiles in display memory
+//
+void markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t  x0 = PANEL_W - x - w, x1 = PANEL_W - 1 - x;
+  int16_t  y0 = PANEL_H - y - h, y1 = PANEL_H - 1 - y;
+  uint8_t  ty;
+  uint32_t mask;
+
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > PANEL_W - 1) x1 = PANEL_W - 1;
+  if (y1 > PANEL_H - 1) y1 = PANEL_H - 1;
+  if (x0 > x1 || y0 > y1) return;
+
+  mask = ((uint32_t)2 << (x1 >> 3)) - ((uint32_t)1 << (x0 >> 3));   // tiles x0/8 .. x1/8 (wraps to 0 for tile 31)
+  for ( ty = y0 >> 3; ty <= (y1 >> 3); ty++)
+    dirtyTiles[ty] |= mask;
+}
+
+#ifdef SSD1322_DIRECT
+  #define markCell markDirect
+#else
+  #define markCell markDirty
+#endif
+
+// compares the state on screen with the next one and marks the areas that changed
+//
+void markChanges(const DisplayState *from, const DisplayState *to) {
+  uint8_t  i, diff, first;
+  uint32_t bar;
+  Box b;
+
+  for ( i=0; i<7 ; i++){
+    if (from->digits[i] != to->digits[i]) markCell(LAY.digitX+(i*LAY.digitPitch), LAY.cellY, LAY.digitPitch, LAY.cellH);
+    if ((from->dp ^ to->dp) & (1<<i)) markCell(LAY.digitX-1+(i*LAY.digitPitch), LAY.readY-2, DP_width, DP_height);
+  }
+  if (from->polarity != to->polarity) markCell(LAY.signX, LAY.cellY, LAY.digitPitch, LAY.cellH);
+  if (from->prefix != to->prefix || from->unit != to->unit) markCell(LAY.unitX, LAY.cellY, LAY.unitW, LAY.cellH);
+
+  for ( i=0; i<ANNUN_DESC_COUNT ; i++){
+    diff = from->annun[pgm_read_byte(&annunDesc[i].ann)] ^ to->annun[pgm_read_byte(&annunDesc[i].ann)];
+    if (diff & pgm_read_byte(&annunDesc[i].mask))
+    {
+      b = annunBox(&annunDesc[i]);
+      markDirty(b.x, b.y, b.w, b.h);
+    }
+  }
+
+  bar = barMask(from) ^ barMask(to);       // one rectangle per run of flipped positions
+  for ( i=0; bar ; i++, bar >>= 1){
+    if (!(bar & 1)) continue;
+    first = i;
+    while (bar & 2) { i++; bar >>= 1; }
+    // a dot joins the next one through the column at BAR(i+1), one more than the positions flipped
+    markDirty(BAR(first), LAY.top-6, (i-first+1)*LAY.barPitch + 1, 7);
+  }
+}
+
+#ifdef SSD1322_DIRECT
+// adds a screen rectangle (drawing coordinates) to the cells sent with sendDirect(), mirrored for U8G2_R2
+// like in markDirty(). Falls back to the dirty tiles when the list is full or the cell too wide for one line
+//
+void markDirect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t  x0 = PANEL_W - x - w, x1 = PANEL_W - 1 - x;
+  int16_t  y0 = PANEL_H - y - h, y1 = PANEL_H - 1 - y;
+  uint8_t  ty;
+  DirectRect *r;
+
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > PANEL_W - 1) x1 = PANEL_W - 1;
+  if (y1 > PANEL_H - 1) y1 = PANEL_H - 1;
+  if (x0 > x1 || y0 > y1) return;
+  if (directCount == DIRECT_MAX || (x1 >> 2) - (x0 >> 2) >= 16) { markDirty(x, y, w, h); return; }
+
+  r = &directRect[directCount++];
+  r->c0 = x0 >> 2;
+  r->c1 = x1 >> 2;
+  r->y0 = y0;
+  r->y1 = y1;
+  for ( ty = y0 >> 3; ty <= (y1 >> 3); ty++)
+    directRows |= 1 << ty;
+}
+
+// every cell of the readout, to send it again at READOUT_GRAY after a full draw
+void markReadout() {
+  uint8_t i;
+
+  for ( i=0; i<7 ; i++){
+    markDirect(LAY.digitX+(i*LAY.digitPitch), LAY.cellY, LAY.digitPitch, LAY.cellH);
+    markDirect(LAY.digitX-1+(i*LAY.digitPitch), LAY.readY-2, DP_width, DP_height);
+  }
+  markDirect(LAY.signX, LAY.cellY, LAY.digitPitch, LAY.cellH);
+  markDirect(LAY.unitX, LAY.cellY, LAY.unitW, LAY.cellH);
+}
+
+// sends the rows of r that are in tile row ty, the u8g2 buffer holds that tile row drawn
+//
+void sendDirect(const DirectRect *r, uint8_t ty) {
+  u8x8_t   *u8x8 = u8g2.getU8x8();
+  uint8_t  *buf = u8g2.getBufferPtr() + (ty - u8g2.getU8g2()->tile_curr_row) * PANEL_W;
+  uint8_t  line[32];                     // one row, 16 columns max
+  uint8_t  y, y0, y1, k, n, bit;
+  uint8_t  *p;
+
+  y0 = r->y0 > ty*8 ? r->y0 : ty*8;
+  y1 = r->y1 < ty*8+7 ? r->y1 : ty*8+7;
+  if (y0 > y1) return;
+  n = (r->c1 - r->c0 + 1) * 2;
+
+  u8x8_cad_StartTransfer(u8x8);
+  u8x8_cad_SendCmd(u8x8, 0x15);          // column window, same offset u8g2 uses
+  u8x8_cad_SendArg(u8x8, r->c0 + u8x8->x_offset);
+  u8x8_cad_SendArg(u8x8, r->c1 + u8x8->x_offset);
+  u8x8_cad_SendCmd(u8x8, 0x75);          // row window
+  u8x8_cad_SendArg(u8x8, y0);
+  u8x8_cad_SendArg(u8x8, y1);
+  u8x8_cad_SendCmd(u8x8, 0x5c);          // write RAM, the address wraps inside the window
+  for ( y=y0; y<=y1 ; y++){
+    bit = 1 << (y & 7);                  // the page buffer is one byte per pixel column, bit 0 on top
+    p = buf + r->c0*4;
+    for ( k=0; k<n ; k++, p+=2)
+      line[k] = (p[0] & bit ? READOUT_GRAY << 4 : 0) | (p[1] & bit ? READOUT_GRAY : 0);
+    u8x8_cad_SendData(u8x8, n, line);
+    STAT(spiBytes += n;)
+  }
+  u8x8_cad_EndTransfer(u8x8);
+}
+#endif
+#endif
+
+// screen area covered by an annunciator, in drawing coordinates
+//
+Box annunBox(const AnnunDesc *d) {
+  Box b;
+  uint8_t asset = pgm_read_byte(&d->asset);
+
+  b.x = pgm_read_byte(&d->x);
+  b.y = pgm_read_byte(&d->y);
+  switch (pgm_read_byte(&d->kind))
+  {
+  case K_XBM:
+    b.w = pgm_read_byte(&annunXbm[asset].w);
+    b.h = pgm_read_byte(&annunXbm[asset].h);
+    break;
+  case K_INV:                             // box drawn by DrawInvStr()
+    b.x -= 2;
+    b.y -= 6;
+    b.w = strlen_P(annunText[asset])*4 + 2;
+    b.h = 7;
+    break;
+  default:                                // tom thumb is 4 pixels per character, on the 6 lines above y
+    b.y -= 6;
+    b.w = strlen_P(annunText[asset])*4;
+    b.h = 7;
+  }
+  return b;
+}
+
+// bargraph positions lit in ds, bit n is BAR(n)
+uint32_t barMask(const DisplayState *ds) {
+  return (ds->annun[ANN_F19] & 0x20 ? 1 : 0) | (uint32_t)barOrder(ds->annun[ANN_F8]) << 1
+         | (uint32_t)barOrder(ds->annun[ANN_F7]) << 9;
+}
+
+// draws the bargraph : the end marks as 6 pixel high lines, the runs of lit dots as one 3 pixel high box each
+void drawBar(uint32_t mask) {
+  uint8_t  n, first;
+
+  if (mask & 1) u8g2.drawVLine(BAR(0)+1, LAY.top-5, 6);
+  if (mask & ((uint32_t)1 << 16)) u8g2.drawVLine(BAR(16)+1, LAY.top-5, 6);
+  STAT(drawCalls += (mask & 1) + ((mask >> 16) & 1);)
+  mask >>= 1;
+  for ( n=1; n<16 ; n++, mask >>= 1){
+    if (!(mask & 1)) continue;
+    first = n;
+    while (n < 15 && (mask & 2)) { n++; mask >>= 1; }
+    u8g2.drawBox(BAR(first)+1, LAY.top-2, (n-first+1)*LAY.barPitch - 1, 3);
+    STAT(drawCalls++;)
+  }
+}
+
+#ifdef TREND
+// row of a sample on the current scale
+uint8_t trendRow(float v) {
+  if (isnan(v)) return TREND_NONE;
+  if (trendHi == trendLo) return TREND_Y + TREND_H/2;
+  return TREND_Y + TREND_H - 1 - (uint8_t)((v - trendLo) * (TREND_H - 1) / (trendHi - trendLo) + 0.5f);
+}
+
+// takes a sample of the reading of ds every TREND_PERIOD ms. Returns true when the plot changed, the
+// columns to redraw are marked in dirtyTiles[]
+bool trendSample(const DisplayState *ds) {
+  Reading  r;
+  float    v, lo, hi;
+  uint8_t  i, next;
+  bool     all = false;
+
+  if (millis() - trendLast < TREND_PERIOD) return false;
+  trendLast = millis();
+
+  readingOf(ds, &r);
+  if (r.unit != trendUnit)               // another function, start a new plot
+  {
+    for ( i=0; i<TREND_W ; i++) trendVal[i] = NAN;
+    trendUnit = r.unit;
+    trendHead = TREND_W - 1;
+    all = true;
+  }
+  v = r.value;
+  for ( ; r.exp > 0 ; r.exp--) v *= 10;
+  for ( ; r.exp < 0 ; r.exp++) v /= 10;
+  if (r.flags & RDG_NAN) v = NAN;
+
+  trendHead = trendHead + 1 < TREND_W ? trendHead + 1 : 0;
+  next = trendHead + 1 < TREND_W ? trendHead + 1 : 0;
+  trendVal[trendHead] = v;
+  trendVal[next] = NAN;                  // blank column in front of the newest sample
+
+  if (all || trendHead == 0 || v < trendLo || v > trendHi)   // false for NAN
+  {
+    lo = INFINITY;
+    hi = -INFINITY;
+    for ( i=0; i<TREND_W ; i++){
+      if (trendVal[i] < lo) lo = trendVal[i];
+      if (trendVal[i] > hi) hi = trendVal[i];
+    }
+    if (lo != trendLo || hi != trendHi)
+    {
+      trendLo = lo;
+      trendHi = hi;
+      all = true;
+    }
+  }
+
+  if (all)
+  {
+    for ( i=0; i<TREND_W ; i++) trendY[i] = trendRow(trendVal[i]);
+#ifdef DIRTY_TILES
+    markDirty(TREND_X, TREND_Y, TREND_W, TREND_H);
+#endif
+  }
+  else
+  {
+    trendY[trendHead] = trendRow(v);
+    trendY[next] = TREND_NONE;
+#ifdef DIRTY_TILES
+    markDirty(TREND_X + trendHead, TREND_Y, 1, TREND_H);
+    markDirty(TREND_X + next, TREND_Y, 1, TREND_H);
+    markDirty(TREND_X + (next + 1) % TREND_W, TREND_Y, 1, TREND_H);   // its segment came from column next
+#endif
+  }
+  return true;
+}
+
+// draws the plot rows y0..y1-1 : each column is a vertical line from the sample on its left to its own, a
+// single dot after a blank column. Column 0 follows column TREND_W-1 in time
+void drawTrend(int16_t y0, int16_t y1) {
+  uint8_t  i, prev, a, b;
+
+  prev = TREND_W - 1;
+  for ( i=0; i<TREND_W ; prev = i++){
+    b = trendY[i];
+    if (b == TREND_NONE) continue;
+    a = trendY[prev];
+    if (a == TREND_NONE) a = b;
+    if (a > b) { a ^= b; b ^= a; a ^= b; }
+    if (b < y0 || a >= y1) continue;     // not on this page
+    u8g2.drawVLine(TREND_X + i, a, b - a + 1);
+    STAT(drawCalls++;)
+  }
+}
+#endif
+
+// draws everything shown by ds in the current page (or tile row). Called once per page.
+//
+void drawState(const DisplayState *ds) {
+    char StrDisp[10];
+    uint8_t  i;  /* index des tableaux sur 8 bit aulieu de 16, on est sur un MCU 8 bit, les calculs en 16, c'est en gros 2 calculs de 8 */
+    uint8_t  kind, asset, dp;
+    int16_t  x, y, h;
+    const AnnunDesc *d;
+    u8g2_t   *page = u8g2.getU8g2();       // user_y0..user_y1 is the part of the screen held by the page buffer
 
     
     u8g2.setFont(u8g2_font_tom_thumb_4x6_tr);   // font for the functions display 
     
-    /* evite le recalcul de toutes les adresses à chaque accès au tableau */
-    /* En gros, à chaque accès a un élément d'un tableau, le code qui est executé est complexe car il recalcule généralement, à chaque fois, l'adresse de la varioable*/
-    /* a chatque frame[x], le code correspondant est &frame+x*sizeof(variable) et sur cetains MCU, une multiplication, c'est plusieurs cycles d'horloge*/ 
-    frame0 = frame[0];
-    frame1 = frame[1];
-    frame2 = frame[2]; 
-    frame7  = frame[7];
-    frame8 = frame[8];
-    frame9 = frame[9]; 
-    frame10 = frame[10];
-    frame11  = frame[11];
-    frame12 = frame[12];
-    frame13 = frame[13]; 
-    frame14 = frame[14]; 
-    frame16 = frame[16]; 
-    frame17 = frame[17]; 
-    frame18 = frame[18]; 
-    frame19 = frame[19];
-
-    /* if (frame16&0x02) c en'est pas terrible point de vue qualité logicielle mais 
-    niveau rapidité ok, d'un point de vue qualitté soft, il faudrait écrire if ((frame16&0x02)==1)  */
-    if (frame16&0x02){u8g2.drawStr(0,yfirtsline,"REM" );}
-    if (frame16&0x20){u8g2.drawStr(16,yfirtsline,"SRQ" );}
-    if (frame17&0x02){u8g2.drawStr(32,yfirtsline,"LSTN" );}
-    if (frame18&0x20){u8g2.drawStr(52,yfirtsline,"TLK" );}
-    if (frame18&0x02){u8g2.drawStr(68,yfirtsline,"ONLY" );}
-    
-    /// todo
-    if (frame19&0x20){u8g2.drawStr(88,yfirtsline,"|");} //Z1 bargraph 
-    if (frame8&0x02){u8g2.drawStr(88+4,yfirtsline,".");} //2
-    if (frame8&0x01){u8g2.drawStr(88+8,yfirtsline,".");}//3
-    if (frame8&0x04){u8g2.drawStr(88+12,yfirtsline,".");} //4
-    if (frame8&0x08){u8g2.drawStr(88+16,yfirtsline,".");} //5
-    if (frame8&0x80){u8g2.drawStr(88+20,yfirtsline,".");} //6
-    if (frame8&0x40){u8g2.drawStr(88+24,yfirtsline,".");}//7
-    if (frame8&0x10){u8g2.drawStr(88+28,yfirtsline,".");}//8
-    if (frame8&0x20){u8g2.drawStr(88+32,yfirtsline,".");}//9
-    if (frame7&0x02){u8g2.drawStr(88+36,yfirtsline,".");}//10
-    if (frame7&0x01){u8g2.drawStr(88+40,yfirtsline,".");}//11
-    if (frame7&0x04){u8g2.drawStr(88+44,yfirtsline,".");}//12
-    if (frame7&0x08){u8g2.drawStr(88+48,yfirtsline,".");}//13
-    if (frame7&0x80){u8g2.drawStr(88+52,yfirtsline,".");}//14
-    if (frame7&0x40){u8g2.drawStr(88+56,yfirtsline,".");}//15
-    if (frame7&0x10){u8g2.drawStr(88+60,yfirtsline,".");}//16
-    if (frame7&0x20){u8g2.drawStr(88+64,yfirtsline,"|");}//17
-//    
-    if (frame2&0x10){u8g2.drawStr(172,yfirtsline+10,"2w" );}
-    if (frame1&0x04){u8g2.drawStr(180,yfirtsline+10,"4w" );}
-    if (frame2&0x40){u8g2.drawStr(180,yfirtsline+20,"HF" );}
-    
-    /* /!\ les strcpy sont gourmands en temps CPU, voir éventuellement la ré écriture de la fct */
-    if (frame1&0x01){strcpy (StrDisp,"SHFT");
-    DrawInvStr ( 172,yfirtsline,StrDisp, strlen(StrDisp));}   
-    if (frame1&0x20){strcpy (StrDisp,"LIM");
-    DrawInvStr ( 192,yfirtsline,StrDisp, strlen(StrDisp));}
-    if (frame0&0x02){strcpy (StrDisp,"DELTA%");
-    DrawInvStr ( 208,yfirtsline,StrDisp, strlen(StrDisp));}
-    if (frame1&0x40){strcpy (StrDisp,"CAL");
-    DrawInvStr ( 192,yfirtsline+10,StrDisp, strlen(StrDisp));}
-    if (frame0&0x01){strcpy (StrDisp,"AX+B");
-    DrawInvStr ( 212,yfirtsline+10,StrDisp, strlen(StrDisp));}
-    if (frame1&0x40){strcpy (StrDisp,"MIN");
-    DrawInvStr ( 192,yfirtsline+20,StrDisp, strlen(StrDisp));}
-    if (frame0&0x04){strcpy (StrDisp,"MAX");
-    DrawInvStr ( 212,yfirtsline+20,StrDisp, strlen(StrDisp));}
-    if (frame1&0x80){strcpy (StrDisp,"READ");
-    DrawInvStr ( 192,yfirtsline+30,StrDisp, strlen(StrDisp));}
-    if (frame0&0x08){strcpy (StrDisp,"BURST");
-    DrawInvStr ( 212,yfirtsline+30,StrDisp, strlen(StrDisp));}
-    if (frame0&0x10){strcpy (StrDisp,"SEQU");
-    DrawInvStr ( 192,yfirtsline+40,StrDisp, strlen(StrDisp));}
-    if (frame0&0x20){strcpy (StrDisp,"DELAY");
-    DrawInvStr ( 212,yfirtsline+40,StrDisp, strlen(StrDisp));}
-    if (frame17&0x10){strcpy (StrDisp,"ZERO");
-    DrawInvStr ( 192,yfirtsline+50,StrDisp, strlen(StrDisp));}
-    if (frame17&0x20){strcpy (StrDisp,"SET");
-    DrawInvStr ( 212,yfirtsline+50,StrDisp, strlen(StrDisp));}
-
-    if (frame1&0x02){u8g2.drawXBM( 160, yfirtsline-6, lsp_width, lsp_height, lsp_bits);}
-    if (frame2&0x20){u8g2.drawXBM( 160, yfirtsline+4, diode_width, diode_height, diode_bits);}
-    if (frame0&0x40){u8g2.drawXBM( 180, yfirtsline+29, AC_width, AC_height, AC_bits);}
-    if (frame0&0x80){u8g2.drawXBM( 180, yfirtsline+36, DC_width, DC_height, DC_bits);}
-    if (frame2&0x80){u8g2.drawXBM( 180, yfirtsline+26, DCAC_width, DCAC_height, DCAC_bits);}
-    if (frame2&0x01){u8g2.drawXBM( 172, yfirtsline+18, DNARROW_width, DNARROW_height, DNARROW_bits);}
-    if (frame2&0x02){u8g2.drawXBM( 172, yfirtsline+13, UPARROW_width, UPARROW_height, UPARROW_bits);}
-    if (frame2&0x04){u8g2.drawXBM( 168, yfirtsline+26, Z_width, Z_height, Z_bits);}
-
-    // bottom line
-    if (frame16&0x01){u8g2.drawXBM( 0, yfirtsline+6, ZAP_width, ZAP_height, ZAP_bits);}
-    if (frame16&0x10){u8g2.drawXBM( 18, yfirtsline+6, UPARROW2_width, UPARROW2_height, UPARROW2_bits);}
-    if (frame17&0x01){u8g2.drawStr(0,yfirtsline+50,"M RNG" );}
-    if (frame17&0x04){u8g2.drawStr(24,yfirtsline+50,"S TRG" );}
-    if (frame17&0x08){u8g2.drawXBM( 45, yfirtsline+44, FCTARROW_width, FCTARROW_height, FCTARROW_bits);}
-    if (frame18&0x80){u8g2.drawStr(52,yfirtsline+50,"SPEED" );}
-    if (frame18&0x40){u8g2.drawStr(72,yfirtsline+50,"1" );} 
-    if (frame18&0x10){u8g2.drawStr(76,yfirtsline+50,"2" );}  
-    if (frame18&0x01){u8g2.drawStr(80,yfirtsline+50,"3" );}  
-    if (frame18&0x04){u8g2.drawStr(84,yfirtsline+50,"4" );}  
-    if (frame18&0x08){u8g2.drawXBM( 90, yfirtsline+44, FCTARROW_width, FCTARROW_height, FCTARROW_bits);}
-    if (frame19&0x80){u8g2.drawStr(97,yfirtsline+50,"FILT" );} 
-    if (frame19&0x40){u8g2.drawStr(117,yfirtsline+50,"NULL" );}  
-    if (frame19&0x10){u8g2.drawXBM( 133, yfirtsline+44, FCTARROW_width, FCTARROW_height, FCTARROW_bits);}
-    if (frame19&0x01){u8g2.drawStr(140,yfirtsline+50,"HOLD" );}  
-    if (frame19&0x04){u8g2.drawStr(160,yfirtsline+50,"PROBE" );}  
-    if (frame19&0x08){u8g2.drawXBM( 182, yfirtsline+44, FCTARROW_width, FCTARROW_height, FCTARROW_bits);}
-    if (frame19&0x02){u8g2.drawXBM(146, yfirtsline+6, S_width, S_height, S_bits);}
+    dp = ds->dp;
+
+    for ( i=0; i<ANNUN_DESC_COUNT ; i++){
+      d = &annunDesc[i];
+      if (!(ds->annun[pgm_read_byte(&d->ann)] & pgm_read_byte(&d->mask))) continue;   // segment off
+
+      x = pgm_read_byte(&d->x);
+      y = pgm_read_byte(&d->y);
+      kind = pgm_read_byte(&d->kind);
+      asset = pgm_read_byte(&d->asset);
+
+      if (kind == K_XBM)
+      {
+        h = pgm_read_byte(&annunXbm[asset].h);
+        if (y + h <= page->user_y0 || y >= page->user_y1) continue;         // not on this page
+        u8g2.drawXBMP(x, y, pgm_read_byte(&annunXbm[asset].w), h, (const unsigned char *)pgm_read_ptr(&annunXbm[asset].bits));
+      }
+      else
+      {
+        if (y + 1 <= page->user_y0 || y - 6 >= page->user_y1) continue;     // text sits on the 6 lines above y
+#ifdef INV_LABELS
+        if (kind == K_INV) drawInvLabel(x, y, asset);
+        else
+#endif
+        {
+          strcpy_P(StrDisp, annunText[asset]);
+          if (kind == K_INV) DrawInvStr(x, y, StrDisp, strlen(StrDisp));
+          else u8g2.drawStr(x, y, StrDisp);
+        }
+      }
+      STAT(drawCalls++;)
+    }
+
+    if (LAY.top + 1 > page->user_y0 && LAY.top - 6 < page->user_y1) drawBar(barMask(ds));
+#ifdef TREND
+    drawTrend(page->user_y0, page->user_y1);
+#endif
 
     // dots
-    if (frame16&0x80){u8g2.drawXBM(20, yfirtsline+34, DP_width, DP_height, DP_bits);}
-    if (frame14&0x08){u8g2.drawXBM(20+17, yfirtsline+34, DP_width, DP_height, DP_bits);}
-    if (frame13&0x08){u8g2.drawXBM(20+(2*17), yfirtsline+34, DP_width, DP_height, DP_bits);}
-    if (frame12&0x08){u8g2.drawXBM(20+(3*17), yfirtsline+34, DP_width, DP_height, DP_bits);}
-    if (frame11&0x08){u8g2.drawXBM(20+(4*17), yfirtsline+34, DP_width, DP_height, DP_bits);}
-    if (frame10&0x08){u8g2.drawXBM(20+(5*17), yfirtsline+34, DP_width, DP_height, DP_bits);}
-    if (frame9&0x08){u8g2.drawXBM(20+(6*17), yfirtsline+34, DP_width, DP_height, DP_bits);}
-    // if (frame[2]&0x08){u8g2.drawXBM(20+12+(7*17), yfirtsline+34, DP_width, DP_height, DP_bits); // originally used to draw the legs
-    //                   u8g2.drawXBM(20+26+(7*17), yfirtsline+34, DP_width, DP_height, DP_bits);} // of the omega symbol useless here
+    for ( i=0; i<7 ; i++){
+      if (dp&(1<<i)){u8g2.drawXBMP(LAY.digitX-1+(i*LAY.digitPitch), LAY.readY-2, DP_width, DP_height, DP_bits); STAT(drawCalls++;)}
+    }
+    // if (frame[2]&0x08){u8g2.drawXBMP(20+12+(7*17), yfirtsline+34, DP_width, DP_height, DP_bits); // originally used to draw the legs
+    //                   u8g2.drawXBMP(20+26+(7*17), yfirtsline+34, DP_width, DP_height, DP_bits);} // of the omega symbol useless here
         
     // second line actual value display + units
 
-    u8g2.setFont(u8g2_font_inr19_mf); // font for  value display 
-     if (frame[16]&0x04){u8g2.drawStr(4,yfirtsline+36,"+" );} // polarity sign
-    else if (frame[16]&0x40) {u8g2.drawStr(4,yfirtsline+36,"-");}
-    
-     j =0;
+#ifdef READOUT_SPRITES
+    if (ds->polarity == POL_PLUS) blitReadout(LAY.signX, '+');     // polarity sign
+    else if (ds->polarity == POL_MINUS) blitReadout(LAY.signX, '-');
+    for ( i=0; i<7 ; i++)
+      blitReadout(LAY.digitX+(i*READOUT_ADVANCE), ds->digits[i]);
+#else
+    u8g2.setFont(READOUT_FONT); // font for  value display 
+     if (ds->polarity == POL_PLUS){u8g2.drawStr(LAY.signX,LAY.readY,"+" );} // polarity sign
+    else if (ds->polarity == POL_MINUS) {u8g2.drawStr(LAY.signX,LAY.readY,"-");}
 
-    for ( i=15; i>8 ; i--){
-      value[j++] = ( sevenSeg2char(frame[i]&0xf7));
-    }
-    u8g2.drawStr(21,yfirtsline+36,value);
+    memcpy(value, ds->digits, 7);
+    value[7] = 0;
+    u8g2.drawStr(LAY.digitX,LAY.readY,value);
+    STAT(drawCalls += (ds->polarity != POL_NONE) + 1;)
+#endif
     
 
     // units prefix
-    u8g2.setFont(u8g2_font_inr16_mf); // slightly smaller font for the units
-
-        lvalintU16 = (uint16_t)frame[5];
-        lvalintU16 = lvalintU16 << 8;
-        lvalintU16 += (uint16_t)frame[6];
+    u8g2.setFont(UNIT_FONT); // slightly smaller font for the units
 
-        switch(lvalintU16)
+        switch(ds->prefix)
         {
-        case 0x2288:
-          u8g2.drawXBM( 138, yfirtsline+20, R_EDGE_width, R_EDGE_height, R_EDGE_bits);
-          value[0] = ' ';
+        case PFX_R_EDGE:
+          u8g2.drawXBMP( LAY.unitX, LAY.readY-16, R_EDGE_width, R_EDGE_height, R_EDGE_bits);
           break;
-        case 0x8282:
-          u8g2.drawXBM( 138, yfirtsline+20, F_EDGE_width, F_EDGE_height, F_EDGE_bits);
-          value[0] = ' ';
+        case PFX_F_EDGE:
+          u8g2.drawXBMP( LAY.unitX, LAY.readY-16, F_EDGE_width, F_EDGE_height, F_EDGE_bits);
           break;
-        case 0x0145:
-          value[0] = 'V';
-          break;
-        case 0xc080:
-          value[0] = 0xb5; // micro
-          break;
-        case 0x4480:
-          value[0] = 'n';
-          break;
-        case 0xD480:
-          value[0] = 'd';
-          break;
-        case 0x0E80:
-          value[0] = 'k';
-          break;
-        case 0x5125:
-          value[0] = 'M';
-          break;
-        case 0x4494:
-          value[0] = 'm';
-          break;
-        case 0x3600:
-          value[0] = 0xB0; // '°'
-          break;
-        case 0xC7D3:
-          value[0] = '%';
-          break;
-          default:
-          value[0] = ' ';
         }
+        value[0] = prefixChar[ds->prefix];
 
-      // prefix
-      
-        lvalintU16 = (uint16_t)frame[3];
-        lvalintU16 = lvalintU16 << 8;
-        lvalintU16 += (uint16_t)frame[4];
-
-        switch(lvalintU16)
+      // unit
+        switch(ds->unit)
         {
-        case 0x2288:
-          u8g2.drawXBM( 152, yfirtsline+20, R_EDGE_width, R_EDGE_height, R_EDGE_bits);
-          value[1] = ' ';
-          break;
-        case 0x8282:
-          u8g2.drawXBM( 152, yfirtsline+20, F_EDGE_width, F_EDGE_height, F_EDGE_bits);
-          value[1] = ' ';
-          break;
-        case 0x217:
-          value[1] = 'P';
-          break;
-        case 0x5415:
-          value[1] = 'H';
+        case UNIT_R_EDGE:
+          u8g2.drawXBMP( LAY.unit2X, LAY.readY-16, R_EDGE_width, R_EDGE_height, R_EDGE_bits);
           break;
-        case 0x2017:
-          value[1] = 'F';
+        case UNIT_F_EDGE:
+          u8g2.drawXBMP( LAY.unit2X, LAY.readY-16, F_EDGE_width, F_EDGE_height, F_EDGE_bits);
           break;
-        case 0xF68A:
-          value[1] = 'B';
+        case UNIT_OHM:      // The omega symbol doesn't exist in the inconsolata font so let's make our own
+          u8g2.drawXBMP( LAY.unit2X, LAY.readY-16, OMEGA_width, OMEGA_height, OMEGA_bits);
           break;
-        case 0x0145:
-          value[1] = 'V';
-          break;
-        case 0x7417:
-          value[1] = 'A';
-          break;
-        case 0x7007:      // The omega symbol doesn't exist in the inconsolata font so let's make our own
-          u8g2.drawXBM( 152, yfirtsline+20, OMEGA_width, OMEGA_height, OMEGA_bits);
-          value[1] = ' ';
-          break;
-        case 0xA00F:
-          value[1] = 'C';
-          break;
-        default:
-          value[1] = ' ';
         }
+        value[1] = unitChar[ds->unit];
 
         value[2] = 0; // null terminated
-          u8g2.drawStr(138,yfirtsline+36,value );
+          u8g2.drawStr(LAY.unitX,LAY.readY,value );
+    STAT(drawCalls += 1 + (ds->prefix == PFX_R_EDGE || ds->prefix == PFX_F_EDGE)
+                        + (ds->unit == UNIT_R_EDGE || ds->unit == UNIT_F_EDGE || ds->unit == UNIT_OHM);)
+}
+#ifdef INV_LABELS
+// draws the inverted annunciator id (T_xx) with its text origin at x, y like DrawInvStr(), by ORing its
+// pre-rendered columns in the tile rows held by the page buffer. Font, font mode and draw color are untouched
+//
+void drawInvLabel(int16_t x, int16_t y, uint8_t id) {
+  u8g2_t   *g = u8g2.getU8g2();
+  const InvLabel *l = &invLabels[id - INV_LABEL_FIRST];
+  uint8_t  w = pgm_read_byte(&l->w);
+  const uint8_t *p = (const uint8_t *)pgm_read_ptr(&l->cols);
+  uint8_t  *buf = u8g2.getBufferPtr() + PANEL_W - (x - 2) - w;     // rightmost column of the box
+  int8_t   shift;
+  uint8_t  r, k;
 
-          
-  } while ( u8g2.nextPage() );
+  for ( r=0; r<g->tile_buf_height ; r++, buf += PANEL_W){
+    shift = (PANEL_H - 1 - y) - (g->tile_curr_row + r) * 8;        // row of bit 0 in this tile row
+    if (shift <= -INV_LABEL_H || shift >= 8) continue;
+    if (shift >= 0)
+      for ( k=0; k<w ; k++) buf[k] |= pgm_read_byte(p + k) << shift;
+    else
+      for ( k=0; k<w ; k++) buf[k] |= pgm_read_byte(p + k) >> -shift;
+  }
 }
+#endif
+
+#ifdef READOUT_SPRITES
+// draws one readout character with its origin at x on the readout baseline by ORing its sprite columns in
+// the tile rows held by the page buffer, a fixed cost whatever the character. Characters missing from the
+// sprite sheet are drawn with the font
+//
+void blitReadout(int16_t x, char c) {
+  u8g2_t   *g = u8g2.getU8g2();
+  uint8_t  *buf = u8g2.getBufferPtr() + PANEL_W - READOUT_SPRITE_W - (x + READOUT_SPRITE_X);
+  uint8_t  idx = 0xff, r, ty, k;
+  const uint8_t *p;
+
+  if ((uint8_t)(c - 32) < 96) idx = pgm_read_byte(&readoutIndex[c - 32]);
+  if (idx == 0xff)
+  {
+    u8g2.setFont(READOUT_FONT);
+    u8g2.drawGlyph(x, READOUT_BASELINE, c);
+    STAT(drawCalls++;)
+    return;
+  }
+
+  for ( r=0; r<g->tile_buf_height ; r++, buf += PANEL_W){
+    ty = g->tile_curr_row + r - READOUT_SPRITE_TY0;
+    if (ty >= READOUT_SPRITE_ROWS) continue;              // also when above the first sprite row
+    p = readoutSprites[idx][ty];
+    for ( k=0; k<READOUT_SPRITE_W ; k++)
+      buf[k] |= pgm_read_byte(p + k);
+  }
+}
+#endif
+
 // draw black on white text
 
 void DrawInvStr ( int xpos , int ypos , char DispStr[], int lgth ) {
@@ -433,151 +1831,111 @@ void DrawInvStr ( int xpos , int ypos , char DispStr[], int lgth ) {
     u8g2.setDrawColor(1);
 }
 
-// function that executes whenever data is received from master
-// this function is registered as an event, see setup()
-// the total of data bytes is 20 ( 40 nibbles) are stored in the right order in the frame[] array the 
+// end of an I2C transaction : once every column has been rewritten the RAM is handed over to loop()
+void pcfEnd() {
+  if (!pcfComplete(pcf)) return;                            // part of the display not refreshed yet
 
-void receiveEvent(int count)  // count should be 22 bytes for the first chunk and 8 for the second. total transmission time 3.5 ms
-{
-  uint8_t idx = 0;                    // index for storing frames 
-  uint8_t data;
+  if (readySlot >= 0) framesDropped++;                      // previous one was never rendered
+  readySlot = fillSlot;
+  fillSlot ^= 1;
+  pcf.ram = (uint8_t *)frameSlot[fillSlot];                 // its columns are all rewritten before it is published
+  framesReceived++;
+}
 
-  while( Wire.available()) // store all the bytes into the buffer 
-  {
-    data = Wire.read();
- //   Serial.print(data,HEX);
- 
-    if (idx > 4)                          // let's drop the 5 first commands
-    {
-       if ( count == 22)               // we onlty need 17 bytes (34 nibbles)  of data 
-       {
-             frame[idx-2] = data;          // get byte in buffer and store in an array from the index 3 
-       }
-
-       
-       if ( count == 8)                // same here we need 3 bytes ( 6 nibbles)
-       {
-             frame[idx-5] = data;         // get byte in buffer and store in an array 
-        } 
-    }
-       idx++;        
-   }
-   transcode();
+#ifdef PCF_BLINK
+// switches the panel off while the LCD would be blank : display disabled, or the off half of the blink
+// period (250, 512 or 1024 ms for BF = 1, 2, 3, close to the 2, 1 and 0.5 Hz of the PCF8576)
+void blinkUpdate() {
+  uint8_t  bf = pcf.blink & 0x03;
+  bool     on = pcf.mode & 0x08;
+
+  if (bf && ((millis() >> (7 + bf)) & 1)) on = false;
+  if (on == panelOn) return;
+  u8g2.setPowerSave(!on);              // display off / on command, the RAM is kept
+  panelOn = on;
 }
+#endif
 
+#ifdef TWI_DIRECT
+// ************************* TWI slave ***********************
+// Replaces Wire for the receive only job we have : every byte is handed to pcfByte() from the TWI interrupt
+// as soon as it is acknowledged, there is no 32 byte buffer to fill then copy again after the STOP condition
+// and the Wire library with its buffers (about 160 bytes of SRAM on AVR) is not linked at all.
+// The PCF8576 is write only, a read from the master gets 0xff.
 
-// seven segments to char conversion
-char sevenSeg2char(uint8_t input)
-{
-  switch(input)
+#ifdef I2C_RECORD
+  #error "I2C_RECORD needs the byte count before the data, use it with the Wire library"
+#endif
+
+#define TWCR_ACK (_BV(TWINT) | _BV(TWEN) | _BV(TWEA) | _BV(TWIE))  // release the bus, ACK the next byte
+
+void twiBegin(uint8_t address) {
+  digitalWrite(SDA, HIGH);         // internal pull-ups, as Wire.begin() does
+  digitalWrite(SCL, HIGH);
+  TWAR = address << 1;             // no general call
+  TWCR = TWCR_ACK;
+}
+
+ISR(TWI_vect) {
+  PROF(static uint32_t rxMicros = 0;)      // time spent in here since the start of the transaction
+  PROF(uint32_t t = PROF_NOW();)
+
+  switch (TW_STATUS)
   {
-  case 0x00:
-    return ' ';
-    break;
-  case 0x01:
-    return '-';
-    break;
-  case 0x02:
-    return '\'';
-    break;
-  case 0x05:
-    return 'R';
-    break;
-  case 0x08:
-    return '.';
-  case 0x12:
-    return '\"';
-    break;
-  case 0x27:
-    return 'F';
-    break;
-  case 0x35:
-    return '?';
-  case 0x37:
-    return 'P';
-    break;
-  case 0x50:
-    return '1';
-    break;
-  case 0x53:
-    return '4';
-    break;
-  case 0x57:
-    return 'H';
-    break;
-  case 0x70:
-    return '7';
-  case 0x73:
-    return 'Q';
-    break;
-  case 0x76:
-    return 'N';
-    break;
-  case 0x77:
-    return 'A';
-    break;
-  case 0x80:
-    return '_';
-    break;
-  case 0x81:
-    return '=';
-  case 0x86:
-    return 'L';
-  case 0x87:
-    return 'T';
-    break;
-  case 0xA6:
-    return 'C';
-    break;
-  case 0xA7:
-    return 'E';
-    break;
-  case 0xB5:
-    return '2';
+  case TW_SR_SLA_ACK:              // addressed, a write transaction starts
+  case TW_SR_ARB_LOST_SLA_ACK:
+    pcfStart(pcf);
     break;
-  case 0xC7:
-    return 'B';
+  case TW_SR_DATA_ACK:             // one byte received
+    pcfByte(pcf, TWDR);
     break;
-  case 0xD3:
-    return 'Y';
+  case TW_SR_STOP:                 // STOP or repeated START
+    pcfEnd();
+    PROF(stageAdd(STAGE_RX, rxMicros + PROF_NOW() - t); rxMicros = 0; t = PROF_NOW();)
     break;
-  case 0xD5:
-    return 'D';
+  case TW_ST_SLA_ACK:              // read request, nothing to give
+  case TW_ST_DATA_ACK:
+    TWDR = 0xff;
     break;
-  case 0xD6:
-    return 'U';
-    break;
-  case 0xE3:
-    return '5';
-    break;
-  case 0xE6:
-    return 'G';
-    break;
-  case 0xE7:
-    return '6';
-    break;
-  case 0xF0:
-    return ']';
-    break;
-  case 0xF1:
-    return '3';
-    break;
-  case 0xF3:
-    return '9';
-    break;
-  case 0xF4:
-    return 'J';
-    break;
-  case 0xF5:
-    return '@';
-    break;
-  case 0xF6:
-    return 'O';
-    break;
-  case 0xF7:
-    return '8';
-    break;
-  default:
-    return '?';
+  case TW_BUS_ERROR:               // illegal START / STOP, release the bus
+    TWCR = TWCR_ACK | _BV(TWSTO);
+    return;
   }
+  TWCR = TWCR_ACK;
+
+  PROF(rxMicros += PROF_NOW() - t;)
 }
+#endif
+
+// function that executes whenever data is received from master
+// this function is registered as an event, see setup()
+// the bytes go through the PCF8576 emulation which parses the commands and writes the data to the addressed
+// columns, pcfEnd() publishes the frame once all 40 columns (20 bytes) have been written
+
+#if !defined(TWI_DIRECT) || defined(FRAME_REPLAY)
+void receiveEvent(int count)  // bytes in this transaction (the PM2525 sends 22 then 8), only recorded by I2C_RECORD
+{
+  uint8_t data;
+  PROF(uint32_t t = PROF_NOW();)
+#ifdef I2C_RECORD
+  bool record = recordStart(count);
+#else
+  (void)count;
+#endif
+
+  pcfStart(pcf);
+  while( i2cBus.available()) // feed all the bytes to the PCF8576 emulation
+  {
+    data = i2cBus.read();
+ //   Serial.print(data,HEX);
+#ifdef I2C_RECORD
+    if (record) txPut(data);
+#endif
+    pcfByte(pcf, data);
+  }
+  pcfEnd();
+
+  PROF(stageAdd(STAGE_RX, PROF_NOW() - t);)
+}
+#endif
+
@@ -0,0 +1,274 @@
+// ************************* PM2525 frame decoding ***********************
+// Turns the 20 bytes of PCF8576 display RAM sent by the meter (a frame) into what the LCD shows : annunciator
+// bits, the 7 digit readout, sign, decimal points, unit and prefix, then into a number. The sketch decodes
+// every frame with it and the host tools (tools/decode_log.cpp) include the same file, so a capture decoded
+// on a PC gives exactly what the converter displays.
+//
+// Nothing in here depends on Arduino : the tables are PROGMEM on AVR and ordinary constants elsewhere.
+
+#ifndef PM2525_DECODE_H
+#define PM2525_DECODE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVR__)
+  #include <avr/pgmspace.h>
+#elif !defined(PROGMEM)                // host build
+  #define PROGMEM
+  #define pgm_read_byte(p) (*(const uint8_t *)(p))
+  #define pgm_read_word(p) (*(const uint16_t *)(p))
+#endif
+
+#define FRAME_SIZE 20
+
+    enum { ANN_F0, ANN_F1, ANN_F2, ANN_F7, ANN_F8, ANN_F16, ANN_F17, ANN_F18, ANN_F19, ANN_COUNT };  // annun[] index
+    enum { POL_NONE, POL_PLUS, POL_MINUS };
+
+    // frame[5..6], first character of the units field
+    enum { PFX_NONE, PFX_R_EDGE, PFX_F_EDGE, PFX_V, PFX_MICRO, PFX_NANO, PFX_D, PFX_KILO, PFX_MEGA, PFX_MILLI,
+           PFX_DEGREE, PFX_PERCENT };
+
+    // frame[3..4], second character of the units field
+    enum { UNIT_NONE, UNIT_R_EDGE, UNIT_F_EDGE, UNIT_P, UNIT_H, UNIT_F, UNIT_B, UNIT_V, UNIT_A, UNIT_OHM, UNIT_C };
+
+    struct DisplayState {
+      uint8_t  annun[ANN_COUNT];   // annunciator and bargraph segments, sign and decimal point bits masked out
+      char     digits[7];          // main readout, left to right
+      uint8_t  dp       : 7;       // decimal points, bit n is the dot on the left of digit n
+      uint8_t  polarity : 2;       // POL_xx
+      uint8_t  prefix   : 4;       // PFX_xx
+      uint8_t  unit     : 4;       // UNIT_xx
+    };
+
+    // the reading as a number : value * 10^exp in the unit, the prefix is already in exp ("-1.23450 mV" is
+    // value = -123450, exp = -8)
+    struct Reading {
+      int32_t  value;              // 0 when RDG_NAN is set
+      int8_t   exp;
+      uint8_t  unit;               // UNIT_xx
+      uint8_t  prefix;             // PFX_xx, kept for the ones that are not a power of ten (dB, degree, %)
+      uint8_t  flags;              // RDG_xx
+    };
+    #define RDG_NAN   0x01         // no number on the readout (overload, "----"...)
+    #define RDG_AC    0x02
+    #define RDG_DC    0x04
+    #define RDG_HOLD  0x08
+    #define RDG_REM   0x10
+    #define RDG_NULL  0x20
+
+    // power of ten of each PFX_xx
+    const int8_t prefixExp[] = {0, 0, 0, 0, -6, -9, 0, 3, 6, -3, 0, 0};
+
+
+// ************************* segment decode tables ***********************
+// The digit codes are looked up in a 256 entry flash table built by the compiler from segChars[], any
+// code not in the list gives '?'. The 16 segment unit and prefix fields go through a perfect hash : the
+// top 4 bits of seg * SEG_HASH pick one of 16 slots holding the only code that can match, both fields get
+// distinct slots with that multiplier (checked by the static_asserts below).
+// Either way a decode is a fixed number of loads.
+
+    struct SegChar { uint8_t seg; char c; };
+    constexpr SegChar segChars[] = {               // 7 segment code (decimal point masked) -> character
+      {0x00, ' '}, {0x01, '-'}, {0x02, '\''}, {0x05, 'R'}, {0x08, '.'}, {0x12, '\"'},
+      {0x27, 'F'}, {0x35, '?'}, {0x37, 'P'}, {0x50, '1'}, {0x53, '4'}, {0x57, 'H'},
+      {0x70, '7'}, {0x73, 'Q'}, {0x76, 'N'}, {0x77, 'A'}, {0x80, '_'}, {0x81, '='},
+      {0x86, 'L'}, {0x87, 'T'}, {0xA6, 'C'}, {0xA7, 'E'}, {0xB5, '2'}, {0xC7, 'B'},
+      {0xD3, 'Y'}, {0xD5, 'D'}, {0xD6, 'U'}, {0xE3, '5'}, {0xE6, 'G'}, {0xE7, '6'},
+      {0xF0, ']'}, {0xF1, '3'}, {0xF3, '9'}, {0xF4, 'J'}, {0xF5, '@'}, {0xF6, 'O'},
+      {0xF7, '8'}};
+    #define SEG_CHARS (sizeof(segChars)/sizeof(segChars[0]))
+
+    constexpr char segChar(uint8_t seg, const SegChar *p, uint8_t n) {
+      return n == 0 ? '?' : p->seg == seg ? p->c : segChar(seg, p + 1, n - 1);
+    }
+    #define SEG1(s)  segChar(s, segChars, SEG_CHARS)
+    #define SEG4(s)  SEG1(s), SEG1(s+1), SEG1(s+2), SEG1(s+3)
+    #define SEG16(s) SEG4(s), SEG4(s+4), SEG4(s+8), SEG4(s+12)
+
+    const char sevenSegTable[256] PROGMEM = {
+      SEG16(0x00), SEG16(0x10), SEG16(0x20), SEG16(0x30), SEG16(0x40), SEG16(0x50), SEG16(0x60), SEG16(0x70),
+      SEG16(0x80), SEG16(0x90), SEG16(0xa0), SEG16(0xb0), SEG16(0xc0), SEG16(0xd0), SEG16(0xe0), SEG16(0xf0)};
+
+    // 16 segment codes of both fields, looked up by segLookup() in the hashed tables below
+    struct SegCode { uint16_t seg; uint8_t code; };
+    constexpr SegCode prefixCodes[] = {
+      {0x2288, PFX_R_EDGE}, {0x8282, PFX_F_EDGE}, {0x0145, PFX_V},    {0xC080, PFX_MICRO},
+      {0x4480, PFX_NANO},   {0xD480, PFX_D},      {0x0E80, PFX_KILO}, {0x5125, PFX_MEGA},
+      {0x4494, PFX_MILLI},  {0x3600, PFX_DEGREE}, {0xC7D3, PFX_PERCENT}};
+    constexpr SegCode unitCodes[] = {
+      {0x2288, UNIT_R_EDGE}, {0x8282, UNIT_F_EDGE}, {0x0217, UNIT_P}, {0x5415, UNIT_H},   {0x2017, UNIT_F},
+      {0xF68A, UNIT_B},      {0x0145, UNIT_V},      {0x7417, UNIT_A}, {0x7007, UNIT_OHM}, {0xA00F, UNIT_C}};
+    #define PREFIX_CODES (sizeof(prefixCodes)/sizeof(prefixCodes[0]))
+    #define UNIT_CODES (sizeof(unitCodes)/sizeof(unitCodes[0]))
+
+    #define SEG_HASH 0x2bd                 // found by trying every odd multiplier, see the static_asserts
+    constexpr uint8_t segHash(uint16_t seg) { return (uint16_t)(seg * SEG_HASH) >> 12; }
+
+    // code of p[0..n-1] landing in slot, {0, 0} (the _NONE codes) when there is none
+    constexpr SegCode hashSlot(const SegCode *p, uint8_t n, uint8_t slot) {
+      return n == 0 ? SegCode{0, 0} : segHash(p->seg) == slot ? *p : hashSlot(p + 1, n - 1, slot);
+    }
+    // true when no two codes of p[0..n-1] share a slot
+    constexpr bool hashFree(const SegCode *p, uint8_t n, uint8_t slot) {
+      return n == 0 || (segHash(p->seg) != slot && hashFree(p + 1, n - 1, slot));
+    }
+    constexpr bool hashPerfect(const SegCode *p, uint8_t n) {
+      return n == 0 || (hashFree(p + 1, n - 1, segHash(p->seg)) && hashPerfect(p + 1, n - 1));
+    }
+    static_assert(hashPerfect(prefixCodes, PREFIX_CODES), "SEG_HASH puts two prefix codes in the same slot");
+    static_assert(hashPerfect(unitCodes, UNIT_CODES), "SEG_HASH puts two unit codes in the same slot");
+
+    #define SLOT4(t, n, s) hashSlot(t, n, s), hashSlot(t, n, s+1), hashSlot(t, n, s+2), hashSlot(t, n, s+3)
+    #define SLOT16(t, n)   SLOT4(t, n, 0), SLOT4(t, n, 4), SLOT4(t, n, 8), SLOT4(t, n, 12)
+    const SegCode prefixTable[16] PROGMEM = { SLOT16(prefixCodes, PREFIX_CODES) };
+    const SegCode unitTable[16] PROGMEM = { SLOT16(unitCodes, UNIT_CODES) };
+
+
+// ************************* decoding ***********************
+
+// seven segments to char conversion
+inline char sevenSeg2char(uint8_t input)
+{
+  return pgm_read_byte(&sevenSegTable[input]);
+}
+
+// code of a 16 segment field, the _NONE code (0) for anything not in the table
+inline uint8_t segLookup(const SegCode *table, uint16_t seg) {
+  const SegCode *e = &table[segHash(seg)];
+
+  return pgm_read_word(&e->seg) == seg ? pgm_read_byte(&e->code) : 0;
+}
+
+// turns the raw frame f into a DisplayState, the 7 segment digits and the 16 segment unit / prefix fields
+// are converted here once per frame instead of once per page when drawing
+//
+inline void decodeFrame(const uint8_t *f, DisplayState *ds) {
+    uint8_t  i, j;
+
+    memset(ds, 0, sizeof(DisplayState));      // also clears the unused bits so states can be compared with memcmp
+
+    ds->annun[ANN_F0]  = f[0];
+    ds->annun[ANN_F1]  = f[1];
+    ds->annun[ANN_F2]  = f[2];
+    ds->annun[ANN_F7]  = f[7];
+    ds->annun[ANN_F8]  = f[8];
+    ds->annun[ANN_F16] = f[16] & ~(0x04 | 0x40 | 0x80);   // sign and first decimal point are decoded below
+    ds->annun[ANN_F17] = f[17];
+    ds->annun[ANN_F18] = f[18];
+    ds->annun[ANN_F19] = f[19];
+
+    if (f[16]&0x04) ds->polarity = POL_PLUS;
+    else if (f[16]&0x40) ds->polarity = POL_MINUS;
+
+    // decimal points, bit n is the dot on the left of digit n
+    if (f[16]&0x80) ds->dp = 0x01;
+    j = 0;
+    for ( i=15; i>8 ; i--){
+      if (j && (f[i]&0x08)) ds->dp |= 1 << j;
+      ds->digits[j++] = sevenSeg2char(f[i]&0xf7);
+    }
+
+    // units prefix and unit
+    ds->prefix = segLookup(prefixTable, ((uint16_t)f[5] << 8) | f[6]);
+    ds->unit = segLookup(unitTable, ((uint16_t)f[3] << 8) | f[4]);
+}
+
+// the number shown by ds. The meter writes its zero as 'O', blank digits are skipped and any other character
+// on the readout makes it RDG_NAN
+inline void readingOf(const DisplayState *ds, Reading *r) {
+  int32_t  v = 0;
+  int8_t   decimals = 0;
+  uint8_t  flags = 0;
+  uint8_t  i;
+  bool     dot = false;
+  char     c;
+
+  for ( i=0; i<7 ; i++){
+    if (ds->dp & (1<<i)) dot = true;     // dot on the left of digit i
+    c = ds->digits[i];
+    if (c == 'O') c = '0';
+    if (c >= '0' && c <= '9')
+    {
+      v = v * 10 + (c - '0');
+      if (dot) decimals++;
+    }
+    else if (c != ' ') flags |= RDG_NAN;
+  }
+  if (flags & RDG_NAN) v = 0;
+  if (ds->polarity == POL_MINUS) v = -v;
+
+  if (ds->annun[ANN_F0] & 0x40) flags |= RDG_AC;
+  if (ds->annun[ANN_F0] & 0x80) flags |= RDG_DC;
+  if (ds->annun[ANN_F2] & 0x80) flags |= RDG_AC | RDG_DC;
+  if (ds->annun[ANN_F19] & 0x01) flags |= RDG_HOLD;
+  if (ds->annun[ANN_F16] & 0x02) flags |= RDG_REM;
+  if (ds->annun[ANN_F19] & 0x40) flags |= RDG_NULL;
+
+  r->value = v;
+  r->exp = prefixExp[ds->prefix] - decimals;
+  r->unit = ds->unit;
+  r->prefix = ds->prefix;
+  r->flags = flags;
+}
+
+
+#ifndef __AVR__
+// ************************* batch decoding ***********************
+// Host side only. decodeFrames() goes straight from frames to Readings without building the DisplayState and
+// its characters : every digit is one load in segDigit[], a table giving the value of each 7 segment code
+// (decimal point included) with the DIGIT_xx marks for the rest, built by the compiler from segChars[] so it
+// can't disagree with sevenSegTable[]. It gives the same Readings as decodeFrame() + readingOf(), which
+// tools/decode_log.cpp --check verifies on a whole capture.
+
+    #define DIGIT_BLANK 0x40
+    #define DIGIT_NAN   0x80
+    #define DIGIT_DOT   0x10                   // the code has the decimal point segment on
+
+    constexpr uint8_t digitOf(char c) {
+      return c == 'O' ? 0 : (c >= '0' && c <= '9') ? c - '0' : c == ' ' ? DIGIT_BLANK : DIGIT_NAN;
+    }
+    #define DIG1(s)  (digitOf(SEG1((s) & 0xf7)) | ((s) & 0x08 ? DIGIT_DOT : 0))
+    #define DIG4(s)  DIG1(s), DIG1(s+1), DIG1(s+2), DIG1(s+3)
+    #define DIG16(s) DIG4(s), DIG4(s+4), DIG4(s+8), DIG4(s+12)
+
+    const uint8_t segDigit[256] = {
+      DIG16(0x00), DIG16(0x10), DIG16(0x20), DIG16(0x30), DIG16(0x40), DIG16(0x50), DIG16(0x60), DIG16(0x70),
+      DIG16(0x80), DIG16(0x90), DIG16(0xa0), DIG16(0xb0), DIG16(0xc0), DIG16(0xd0), DIG16(0xe0), DIG16(0xf0)};
+
+// decodes n frames of FRAME_SIZE bytes each from frames into out[0..n-1]
+inline void decodeFrames(const uint8_t *frames, size_t n, Reading *out) {
+  for ( ; n ; n--, frames += FRAME_SIZE, out++){
+    const uint8_t *f = frames;
+    int32_t  v = 0;
+    uint8_t  nan = 0, dot = f[16] & 0x80, decimals = 0, d, i, flags;
+
+    for ( i=15; i>8 ; i--){
+      d = segDigit[f[i]];
+      if (i != 15) dot |= d & DIGIT_DOT;      // the first dot is in f[16], f[15] bit 3 isn't one
+      nan |= d;
+      if (d & (DIGIT_BLANK | DIGIT_NAN)) continue;
+      v = v * 10 + (d & 0x0f);
+      decimals += dot != 0;
+    }
+    flags = (nan & DIGIT_NAN) ? RDG_NAN : 0;
+    if (flags) v = 0;
+    if ((f[16] & 0x44) == 0x40) v = -v;       // minus only, plus wins when both are on
+
+    if (f[0] & 0x40) flags |= RDG_AC;
+    if (f[0] & 0x80) flags |= RDG_DC;
+    if (f[2] & 0x80) flags |= RDG_AC | RDG_DC;
+    if (f[19] & 0x01) flags |= RDG_HOLD;
+    if (f[16] & 0x02) flags |= RDG_REM;
+    if (f[19] & 0x40) flags |= RDG_NULL;
+
+    out->prefix = segLookup(prefixTable, ((uint16_t)f[5] << 8) | f[6]);
+    out->unit = segLookup(unitTable, ((uint16_t)f[3] << 8) | f[4]);
+    out->value = v;
+    out->exp = prefixExp[out->prefix] - decimals;
+    out->flags = flags;
+  }
+}
+#endif
+
+#endif
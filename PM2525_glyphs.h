@@ -0,0 +1,124 @@
+// generated by tools/glyph_assets.py from assets/glyphs, do not edit
+//
+// glyph      size   xbm  rle
+// OMEGA      14x16   32   31
+// ZAP        12x9    18   19
+// S           5x7     7   12
+// UPARROW2    7x7     7   13
+// DP          2x2     2    5
+// lsp         8x7     7   17
+// diode       8x7     7   15
+// DC          8x6     6   11
+// AC          7x3     3   10
+// DCAC        7x1     1    5
+// DNARROW     5x3     3   10
+// UPARROW     5x3     3    9
+// Z           9x11   22   10
+// FCTARROW    5x6     6   11
+// R_EDGE     14x16   32   16
+// F_EDGE     14x16   32   14
+// total             188  233 bytes of flash, rle as a u8g2 font with 25 bytes of header and end mark
+
+   // Ohms glyph, not in the inconsolata font
+    #define OMEGA_width 14
+    #define OMEGA_height 16
+    static const unsigned char OMEGA_bits[] PROGMEM = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xe0, 0x01, 0xf8, 0x07, 0x1c, 0x0e,
+    0x0c, 0x0c, 0x06, 0x18, 0x06, 0x18, 0x06, 0x18, 0x06, 0x18, 0x0c, 0x0c,
+    0x18, 0x06, 0x18, 0x06, 0x1e, 0x1e, 0x1e, 0x1e};
+
+   // zap glyph
+    #define ZAP_width 12
+    #define ZAP_height 9
+    static const unsigned char ZAP_bits[] PROGMEM = {
+    0x00, 0x08, 0x00, 0x0c, 0x20, 0x06, 0x70, 0x03, 0xd8, 0x01, 0x8d, 0x00,
+    0x07, 0x00, 0x07, 0x00, 0x0f, 0x00};
+
+   // S glyph
+    #define S_width 5
+    #define S_height 7
+    static const unsigned char S_bits[] PROGMEM = {
+    0x0e, 0x01, 0x01, 0x0e, 0x10, 0x10, 0x0e};
+
+   // up arrow on the top left corner
+    #define UPARROW2_width 7
+    #define UPARROW2_height 7
+    static const unsigned char UPARROW2_bits[] PROGMEM = {
+    0x08, 0x1c, 0x2a, 0x49, 0x08, 0x08, 0x08};
+
+   // decimal dot
+    #define DP_width 2
+    #define DP_height 2
+    static const unsigned char DP_bits[] PROGMEM = {
+    0x03, 0x03};
+
+   // loudspeaker glyph
+    #define lsp_width 8
+    #define lsp_height 7
+    static const unsigned char lsp_bits[] PROGMEM = {
+    0x60, 0x50, 0x4e, 0x46, 0x4e, 0x50, 0x60};
+
+   // diode glyph
+    #define diode_width 8
+    #define diode_height 7
+    static const unsigned char diode_bits[] PROGMEM = {
+    0x00, 0x24, 0x34, 0xff, 0x34, 0x24, 0x00};
+
+   // DC glyph
+    #define DC_width 8
+    #define DC_height 6
+    static const unsigned char DC_bits[] PROGMEM = {
+    0xff, 0x00, 0x00, 0xdb, 0x00, 0x00};
+
+   // AC glyph
+    #define AC_width 7
+    #define AC_height 3
+    static const unsigned char AC_bits[] PROGMEM = {
+    0x06, 0x49, 0x30};
+
+   // DC glyph on top of the AC symbol
+    #define DCAC_width 7
+    #define DCAC_height 1
+    static const unsigned char DCAC_bits[] PROGMEM = {
+    0x7f};
+
+   // down arrow on the upper right
+    #define DNARROW_width 5
+    #define DNARROW_height 3
+    static const unsigned char DNARROW_bits[] PROGMEM = {
+    0x11, 0x0a, 0x04};
+
+   // up arrow on the upper right
+    #define UPARROW_width 5
+    #define UPARROW_height 3
+    static const unsigned char UPARROW_bits[] PROGMEM = {
+    0x04, 0x0a, 0x11};
+
+   // Z glyph
+    #define Z_width 9
+    #define Z_height 11
+    static const unsigned char Z_bits[] PROGMEM = {
+    0x00, 0x00, 0xfc, 0x00, 0x80, 0x00, 0x40, 0x00, 0x20, 0x00, 0x10, 0x00,
+    0x08, 0x00, 0x04, 0x00, 0x02, 0x00, 0x7e, 0x00, 0x00, 0x00};
+
+   // function arrows at the bottom line (won't line up with the bezel though)
+    #define FCTARROW_width 5
+    #define FCTARROW_height 6
+    static const unsigned char FCTARROW_bits[] PROGMEM = {
+    0x04, 0x04, 0x04, 0x1f, 0x0e, 0x04};
+
+   // rising edge
+    #define R_EDGE_width 14
+    #define R_EDGE_height 16
+    static const unsigned char R_EDGE_bits[] PROGMEM = {
+    0x00, 0x00, 0x00, 0x00, 0x80, 0x0f, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00,
+    0x80, 0x00, 0xc0, 0x01, 0xe0, 0x03, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00,
+    0x80, 0x00, 0xfc, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+   // falling edge
+    #define F_EDGE_width 14
+    #define F_EDGE_height 16
+    static const unsigned char F_EDGE_bits[] PROGMEM = {
+    0x00, 0x00, 0x00, 0x00, 0xfc, 0x00, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00,
+    0x80, 0x00, 0xe0, 0x03, 0xc0, 0x01, 0x80, 0x00, 0x80, 0x00, 0x80, 0x00,
+    0x80, 0x00, 0x80, 0x0f, 0x00, 0x00, 0x00, 0x00};
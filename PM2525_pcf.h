@@ -0,0 +1,96 @@
+// ************************* PCF8576 emulation ***********************
+// Every transaction starts with command bytes, bit 7 set meaning another command follows, then display
+// data. The data bytes go to the RAM position given by the data pointer, in 1:4 multiplex mode (the one
+// used by the PM2525) a byte holds 2 columns of 4 segments, high nibble first, and the pointer moves by 2.
+// ram[n] holds columns 2n and 2n+1 which is the frame[] layout of PM2525_decode.h. When the pointer goes past
+// the last column, the following data is for the next cascaded PCF8576.
+//
+// The sketch feeds it from the I2C interrupt, the host tools (tools/capture_replay.cpp) with the transactions
+// of an I2C_RECORD capture, so both turn the same bytes into the same frames.
+//
+// Nothing in here depends on Arduino.
+
+#ifndef PM2525_PCF_H
+#define PM2525_PCF_H
+
+#include <stdint.h>
+#include <string.h>
+
+// with PCF_SUBADDRESS defined before including this file only the data sent to that subaddress is kept
+
+    enum { PCF_CMD, PCF_DATA };
+
+    struct Pcf8576 {
+      uint8_t  *ram;                   // display RAM, 40 columns of 4 bits
+      uint8_t  state;                  // PCF_CMD or PCF_DATA
+      uint8_t  ptr;                    // data pointer, column 0..39
+      uint8_t  subaddr;                // device select, incremented when the pointer wraps
+      uint8_t  written[5];             // columns written since the last complete frame, one bit each
+      volatile uint8_t mode;           // last mode set command : LP E B M1 M0
+      volatile uint8_t blink;          // last blink command : A BF1 BF0
+      volatile uint8_t bank;           // last bank select command : I O
+    };
+
+// start of an I2C transaction, the PCF8576 expects commands first
+inline void pcfStart(Pcf8576 &pcf) {
+  pcf.state = PCF_CMD;
+}
+
+// one byte of an I2C transaction : commands are executed, data goes straight to the addressed RAM columns
+inline void pcfByte(Pcf8576 &pcf, uint8_t data) {
+  uint8_t cmd, col, n;
+
+  if (pcf.state == PCF_CMD)
+  {
+    cmd = data & 0x7f;
+    if (!(cmd & 0x40)) pcf.ptr = cmd < 40 ? cmd : 0;          // load data pointer   C 0 P5..P0
+    else if ((cmd & 0x60) == 0x40) pcf.mode = cmd & 0x1f;     // mode set            C 1 0 LP E B M1 M0
+    else if ((cmd & 0x78) == 0x60) pcf.subaddr = cmd & 0x07;  // device select       C 1 1 0 0 A2 A1 A0
+    else if ((cmd & 0x7c) == 0x78) pcf.bank = cmd & 0x03;     // bank select         C 1 1 1 1 0 I O
+    else if ((cmd & 0x78) == 0x70) pcf.blink = cmd & 0x07;    // blink               C 1 1 1 0 A BF1 BF0
+    if (!(data & 0x80)) pcf.state = PCF_DATA;                 // last command, display data follows
+    return;
+  }
+
+#ifdef PCF_SUBADDRESS
+  if (pcf.subaddr == PCF_SUBADDRESS)
+#endif
+  {
+    col = pcf.ptr;
+    n = col >> 1;
+    if (!(col & 1))
+    {
+      pcf.ram[n] = data;                                     // aligned, 2 columns at once
+      pcf.written[col >> 3] |= 3 << (col & 7);
+    }
+    else                                                     // odd pointer, the byte spans 2 RAM bytes
+    {
+      pcf.ram[n] = (pcf.ram[n] & 0xf0) | (data >> 4);
+      pcf.written[col >> 3] |= 1 << (col & 7);
+      col = col + 1 < 40 ? col + 1 : 0;
+      n = col >> 1;
+      pcf.ram[n] = (pcf.ram[n] & 0x0f) | (data << 4);
+      pcf.written[col >> 3] |= 1 << (col & 7);
+    }
+  }
+
+  pcf.ptr += 2;
+  if (pcf.ptr >= 40)
+  {
+    pcf.ptr -= 40;
+    pcf.subaddr = (pcf.subaddr + 1) & 0x07;
+  }
+}
+
+// end of an I2C transaction : true once every column has been rewritten since the last time, ram[] then
+// holds a complete frame
+inline bool pcfComplete(Pcf8576 &pcf) {
+  uint8_t i;
+
+  for ( i=0; i<5 ; i++)
+    if (pcf.written[i] != 0xff) return false;                // part of the display not refreshed yet
+  memset(pcf.written, 0, sizeof(pcf.written));
+  return true;
+}
+
+#endif
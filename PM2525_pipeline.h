@@ -0,0 +1,63 @@
+// ************************* latest-wins hand over ***********************
+// Passes values from one producer to one consumer running at the same time (the two cores of an RP2040 with
+// DUAL_CORE, two threads in tools/pipeline_stress.cpp), without locks. It is a triple buffer : the producer
+// writes the value in back() then publish()es it, the consumer take()s the newest value published since its
+// last take() and reads it in front(). Values published while the consumer is busy replace each other, so
+// the consumer always gets the latest one and a value is never read while it is being written.
+//
+// Only atomic loads and stores of one byte are used, no exchange : the Cortex-M0+ of the RP2040 has no
+// LDREX/STREX and its compiler turns read-modify-write atomics into library calls taking a spinlock, while
+// loads and stores stay single instructions with barriers. Each side owns one index, latest for the producer
+// and reading for the consumer, stores it then reads the other one, both sequentially consistent :
+//   - publish() stores latest, then picks the next slot to write out of latest and reading,
+//   - take() stores reading = latest, then checks latest hasn't moved. If it has, publish() may have picked
+//     that slot before seeing the claim, take() claims the newer one and checks again.
+// The producer never waits, the consumer only goes round again when a publish() falls between its store
+// and its load.
+//
+// Nothing in here depends on Arduino, it only needs <atomic> (not available on AVR).
+
+#ifndef PM2525_PIPELINE_H
+#define PM2525_PIPELINE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#if __cplusplus >= 201703L && !defined(ARDUINO)
+  static_assert(std::atomic<uint8_t>::is_always_lock_free, "LatestBox needs lock-free byte loads and stores");
+#endif
+
+template <typename T> struct LatestBox {
+    T        slot[3];
+    std::atomic<uint8_t> latest;       // slot last published, written by the producer only
+    std::atomic<uint8_t> reading;      // slot held by the consumer, written by the consumer only
+    uint8_t  writing;                  // slot the producer is filling, never latest nor reading
+
+    LatestBox() : latest(1), reading(1), writing(0) {}   // latest == reading : nothing new to take
+
+    // producer side
+    T &back() { return slot[writing]; }
+    void publish() {
+      uint8_t l = writing, r;
+
+      latest.store(l, std::memory_order_seq_cst);
+      r = reading.load(std::memory_order_seq_cst);
+      for ( writing=0; writing == l || writing == r ; writing++) {}
+    }
+
+    // consumer side : true when front() holds a value not taken before
+    bool take() {
+      uint8_t l = latest.load(std::memory_order_seq_cst), r;
+
+      if (l == reading.load(std::memory_order_relaxed)) return false;
+      do {
+        r = l;
+        reading.store(r, std::memory_order_seq_cst);   // publish() won't pick it from now on
+        l = latest.load(std::memory_order_seq_cst);    // but may have picked it just before
+      } while (l != r);
+      return true;
+    }
+    const T &front() const { return slot[reading.load(std::memory_order_relaxed)]; }
+};
+
+#endif
@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+# Compares the report of the cycle benchmark (CYCLE_BENCH in the sketch) with a saved one.
+#
+#   python3 tools/bench_check.py bench.txt                      prints the report as a table
+#   python3 tools/bench_check.py bench.txt baseline.txt [-t 2]  also compares, exit code 1 on a regression
+#
+# bench.txt is what the sketch printed on Serial (a capture of the serial monitor, or of the UART under simavr
+# which tools/bench_sim.py runs), other lines are ignored. Every number of a stage, frame or sram line that grew by more than
+# -t percent (0 by default, the counts don't vary from one run to the next) since baseline.txt is a
+# regression. A different bench line (clock, panel, buffer or frame count) means the two can't be compared.
+
+import re
+import sys
+
+KINDS = ("bench", "stage", "frame", "sram")
+
+
+def load(path):
+    # {(kind, stage name or ""): {key: value}}
+    out = {}
+    for line in open(path, errors="replace"):
+        words = line.split()
+        if not words or words[0] not in KINDS:
+            continue
+        fields = dict(w.split("=", 1) for w in words[1:] if re.match(r"\w+=\S+$", w))
+        name = fields.pop("name", "")
+        out[(words[0], name)] = {k: int(v) for k, v in fields.items() if re.match(r"-?\d+$", v)}
+    if ("bench", "") not in out:
+        sys.exit("%s : no cycle benchmark report" % path)
+    return out
+
+
+def main():
+    args = sys.argv[1:]
+    tolerance = 0.0
+    if "-t" in args:
+        i = args.index("-t")
+        tolerance = float(args[i + 1])
+        del args[i:i + 2]
+    if len(args) not in (1, 2):
+        sys.exit("usage: bench_check.py bench.txt [baseline.txt] [-t percent]")
+
+    new = load(args[0])
+    old = load(args[1]) if len(args) == 2 else {}
+    if old and old[("bench", "")] != new[("bench", "")]:
+        sys.exit("not the same benchmark : %s / %s" % (old[("bench", "")], new[("bench", "")]))
+
+    worse = 0
+    for (kind, name), fields in new.items():
+        if kind == "bench":
+            continue
+        for key, value in fields.items():
+            label = "%s %s %s" % (kind, name, key) if name else "%s %s" % (kind, key)
+            ref = old.get((kind, name), {}).get(key)
+            if ref is None:
+                print("%-24s %10d" % (label, value))
+                continue
+            change = (value - ref) * 100.0 / ref if ref else (100.0 if value else 0.0)
+            bad = change > tolerance and (kind, key) != ("sram", "size")
+            worse += bad
+            print("%-24s %10d %10d %+7.1f %%%s" % (label, value, ref, change, "  <<<" if bad else ""))
+    if old:
+        print("%d regression%s" % (worse, "" if worse == 1 else "s"))
+    return 1 if worse else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
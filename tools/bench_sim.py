@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+# Runs the cycle benchmark (CYCLE_BENCH in the sketch) unattended under simavr and compares its report with
+# the saved one, so a regression of the frame path is caught without a board.
+#
+#   python3 tools/bench_sim.py [-o dir] [-t percent] [-T seconds] [--update]
+#
+# Builds the Nano image with arduino-cli (the U8g2 library installed) and -DCYCLE_BENCH, from a copy of the
+# sketch with FRAME_REPLAY and REPLAY_PERIOD 0 set as the benchmark needs, runs it with
+#   simavr -m atmega328p -f 16000000 PM2525_OLED.ino.elf
+# and writes what the sketch sends on its UART to dir/bench.txt (bench_out by default) until the report is
+# complete, or fails after -T seconds (300 by default). The report then goes to bench_check.py with
+# tools/bench_baseline.txt, the exit code is bench_check's : 1 when a number grew by more than -t percent (0 by
+# default, the simulator counts the same cycles on every run).
+# --update copies the report to tools/bench_baseline.txt instead : the first time, and after a change meant
+# to alter the numbers. Commit it with the change.
+
+import os
+import re
+import shutil
+import signal
+import subprocess
+import sys
+import threading
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(TOOLS, "..")
+BASELINE = os.path.join(TOOLS, "bench_baseline.txt")
+FQBN = "arduino:avr:nano"
+SIMAVR = ["simavr", "-m", "atmega328p", "-f", "16000000"]
+sys.path.insert(0, TOOLS)
+from render_check import sketch_source         # noqa: E402   FRAME_REPLAY and REPLAY_PERIOD 0 set
+
+
+def run(cmd):
+    r = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    if r.returncode:
+        sys.exit("%s\n%s failed" % (r.stdout, " ".join(cmd)))
+
+
+def build(out):
+    # arduino-cli wants the .ino in a directory of the same name, with the headers next to it
+    sketch = os.path.join(out, "PM2525_OLED")
+    shutil.rmtree(sketch, ignore_errors=True)
+    os.makedirs(sketch)
+    for name in os.listdir(ROOT):
+        if name.startswith("PM2525_") and name.endswith(".h"):
+            shutil.copy(os.path.join(ROOT, name), sketch)
+    open(os.path.join(sketch, "PM2525_OLED.ino"), "w", encoding="latin-1").write(sketch_source({}, True))
+    image = os.path.join(out, "image")
+    run(["arduino-cli", "compile", "--fqbn", FQBN, "--build-property", "build.extra_flags=-DCYCLE_BENCH",
+         "--output-dir", image, sketch])
+    return os.path.join(image, "PM2525_OLED.ino.elf")
+
+
+def simulate(elf, report, timeout):
+    # simavr prints the UART a line at a time, in color, and never stops : read until the last line of the
+    # report (sram ...), then kill it
+    cmd = SIMAVR + [elf]
+    if shutil.which("stdbuf"):
+        cmd = ["stdbuf", "-oL", "-eL"] + cmd       # its output is a pipe here, don't let it sit in a buffer
+    proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True,
+                            errors="replace", start_new_session=True)
+
+    def stop():
+        try:
+            os.killpg(proc.pid, signal.SIGKILL)   # with whatever it started, they hold the pipe too
+        except ProcessLookupError:
+            pass
+
+    timer = threading.Timer(timeout, stop)
+    timer.start()
+    lines, done = [], False
+    for line in proc.stdout:
+        line = re.sub(r"\x1b\[[0-9;]*m", "", line).strip()
+        if not line:
+            continue
+        lines.append(line)
+        if line.startswith("sram "):
+            done = True
+            break
+    timer.cancel()
+    stop()
+    proc.wait()
+    open(report, "w").write("\n".join(lines) + "\n")
+    return done
+
+
+def main():
+    args = sys.argv[1:]
+    out, tolerance, timeout, update = "bench_out", "0", 300.0, False
+    while args:
+        a = args.pop(0)
+        if a == "-o" and args:
+            out = args.pop(0)
+        elif a == "-t" and args:
+            tolerance = args.pop(0)
+        elif a == "-T" and args:
+            timeout = float(args.pop(0))
+        elif a == "--update":
+            update = True
+        else:
+            sys.exit("usage: bench_sim.py [-o dir] [-t percent] [-T seconds] [--update]")
+    for tool in ("arduino-cli", "simavr"):
+        if not shutil.which(tool):
+            sys.exit("%s is not installed" % tool)
+
+    os.makedirs(out, exist_ok=True)
+    elf = build(out)
+    report = os.path.join(out, "bench.txt")
+    if not simulate(elf, report, timeout):
+        sys.exit("no complete report from simavr after %g s, see %s" % (timeout, report))
+
+    if update:
+        shutil.copy(report, BASELINE)
+        print("%s updated" % BASELINE)
+        return 0
+    if not os.path.exists(BASELINE):
+        sys.exit("no %s yet, run bench_sim.py --update once to create it" % BASELINE)
+    return subprocess.call([sys.executable, os.path.join(TOOLS, "bench_check.py"), report, BASELINE,
+                            "-t", tolerance])
+
+
+if __name__ == "__main__":
+    sys.exit(main())
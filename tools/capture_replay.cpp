@@ -0,0 +1,132 @@
+// Replays an I2C_RECORD capture of the sketch on a PC : every recorded transaction goes through the PCF8576
+// emulation of the sketch (PM2525_pcf.h) and every complete frame through its decoder (PM2525_decode.h).
+//
+//   g++ -O2 -std=c++11 -o capture_replay tools/capture_replay.cpp
+//   ./capture_replay [-r] [-f] capture.bin > readings.csv
+//
+// capture.bin is what the sketch sent over Serial with I2C_RECORD, records of
+//
+//    0xA5  count  lost  t0 t1 t2 t3  byte[0] .. byte[count-1]
+//
+// (see the I2C capture section of the sketch). Bytes before the first record or between records, a serial
+// monitor started late for instance, are skipped. Each complete frame gives one CSV line : micros() of the
+// transaction that completed it, value (empty for RDG_NAN), exponent, unit, prefix and flags codes of the
+// Reading, as decode_log writes them, and the records the sketch dropped since the previous frame.
+// -f writes the 20 byte frames instead, the input of decode_log and pipeline_stress.
+//
+// The file is mapped in memory and replayed at full speed by default, -r replays it in real time : every
+// transaction is handled at its recorded micros(), relative to the first one, to watch the readings come
+// out as the meter sent them. The counts and the time taken go to stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../PM2525_pcf.h"
+#include "../PM2525_decode.h"
+
+#define RECORD_HEADER 7
+#define RECORD_MAX 32                  // Wire buffer, a longer count means we are not on a record
+
+int main(int argc, char **argv) {
+  bool     realTime = false, frames = false;
+  const char *path = NULL;
+  int      a;
+
+  for ( a=1; a<argc ; a++){
+    if (!strcmp(argv[a], "-r")) realTime = true;
+    else if (!strcmp(argv[a], "-f")) frames = true;
+    else path = argv[a];
+  }
+  if (!path)
+  {
+    fprintf(stderr, "usage: capture_replay [-r] [-f] capture.bin\n");
+    return 2;
+  }
+
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0)
+  {
+    perror(path);
+    return 1;
+  }
+  size_t size = st.st_size;
+  const uint8_t *cap = NULL;
+  if (size > 0)
+  {
+    cap = (const uint8_t *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (cap == MAP_FAILED)
+    {
+      perror(path);
+      return 1;
+    }
+    madvise((void *)cap, size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  uint8_t  ram[FRAME_SIZE];
+  Pcf8576  pcf = {ram, PCF_CMD, 0, 0, {0, 0, 0, 0, 0}, 0x08, 0, 0};
+  DisplayState ds;
+  Reading  r;
+  size_t   pos = 0, records = 0, complete = 0, skipped = 0, lost = 0, lostFrame = 0;
+  uint32_t t, last = 0;
+  uint64_t elapsed = 0;                // micros since the first record, across the 32 bit wraps
+  uint8_t  count, i;
+  auto start = std::chrono::steady_clock::now();
+
+  memset(ram, 0xff, sizeof(ram));
+  if (!frames) printf("micros,value,exp,unit,prefix,flags,lost\n");
+  while (pos + RECORD_HEADER <= size)
+  {
+    const uint8_t *rec = cap + pos;
+    count = rec[1];
+    if (rec[0] != 0xA5 || count == 0 || count > RECORD_MAX || pos + RECORD_HEADER + count > size)
+    {
+      pos++;                           // not a record, look for the next 0xA5
+      skipped++;
+      continue;
+    }
+    pos += RECORD_HEADER + count;
+    records++;
+    lost += rec[2];
+    lostFrame += rec[2];
+    t = rec[3] | (rec[4] << 8) | (rec[5] << 16) | ((uint32_t)rec[6] << 24);
+    if (records > 1) elapsed += (uint32_t)(t - last);
+    last = t;
+    if (realTime) std::this_thread::sleep_until(start + std::chrono::microseconds(elapsed));
+
+    pcfStart(pcf);
+    for ( i=0; i<count ; i++) pcfByte(pcf, rec[RECORD_HEADER + i]);
+    if (!pcfComplete(pcf)) continue;
+    complete++;
+
+    if (frames)
+    {
+      fwrite(ram, FRAME_SIZE, 1, stdout);
+    }
+    else
+    {
+      decodeFrame(ram, &ds);
+      readingOf(&ds, &r);
+      if (r.flags & RDG_NAN) printf("%lu,,%d,%u,%u,%u,%lu\n", (unsigned long)t, r.exp, r.unit, r.prefix, r.flags, (unsigned long)lostFrame);
+      else printf("%lu,%ld,%d,%u,%u,%u,%lu\n", (unsigned long)t, (long)r.value, r.exp, r.unit, r.prefix, r.flags, (unsigned long)lostFrame);
+    }
+    lostFrame = 0;
+    if (realTime) fflush(stdout);
+  }
+  skipped += size - pos;
+  if (cap) munmap((void *)cap, size);
+
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "%zu records, %zu frames, %zu records lost by the sketch, %zu bytes skipped\n", records, complete, lost, skipped);
+  fprintf(stderr, "%.3f s recorded, replayed in %.3f s\n", elapsed / 1e6, s);
+  return 0;
+}
@@ -0,0 +1,248 @@
+// Decodes a capture of PM2525 frames on a PC with the decoder of the sketch (PM2525_decode.h).
+//
+//   g++ -O2 -std=c++11 -pthread -o decode_log tools/decode_log.cpp
+//   ./decode_log [-j threads] [-b | -n] [--check] frames.bin > readings.csv
+//   ./decode_log --selftest
+//
+// frames.bin is a sequence of 20 byte frames, the PCF8576 display RAM as the sketch has it in frame[]. Each
+// frame gives one CSV line : value (empty for RDG_NAN), exponent, unit, prefix and flags codes of the Reading.
+// -b writes the Readings as they are in memory (8 bytes each, little endian) instead, -n only decodes,
+// to time it. --check also decodes every frame the way the sketch does, decodeFrame() then readingOf(), and
+// counts the frames where decodeFrames() gives something else. --selftest compares the lookup tables of
+// PM2525_decode.h (sevenSegTable[], prefixTable[], unitTable[]) with the switches they replaced, for all 256
+// digit codes and all 65536 values of both 16 segment fields, no file needed.
+//
+// The file is read in blocks of BLOCK frames, each block is split between the threads (one per core by
+// default) and the results are written in the order of the frames. The time taken goes to stderr.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../PM2525_decode.h"
+
+static const size_t BLOCK = 1 << 20;             // frames per block, 20 MB of input
+
+static_assert(sizeof(Reading) == 8, "-b writes Readings as they are in memory");
+
+enum { OUT_CSV, OUT_BINARY, OUT_NONE };
+
+struct Part {
+  const uint8_t *frames;
+  size_t   n;
+  Reading  *out;
+  std::string text;
+  size_t   mismatches;
+};
+
+static void csvLine(std::string &text, const Reading &r) {
+  char line[48];
+  int  len;
+
+  if (r.flags & RDG_NAN) len = snprintf(line, sizeof(line), ",%d,%u,%u,%u\n", r.exp, r.unit, r.prefix, r.flags);
+  else len = snprintf(line, sizeof(line), "%ld,%d,%u,%u,%u\n", (long)r.value, r.exp, r.unit, r.prefix, r.flags);
+  text.append(line, len);
+}
+
+// the decoding of the sketch before the tables, kept as the reference of --selftest
+static char oldSevenSeg2char(uint8_t input) {
+  switch (input)
+  {
+  case 0x00: return ' ';
+  case 0x01: return '-';
+  case 0x02: return '\'';
+  case 0x05: return 'R';
+  case 0x08: return '.';
+  case 0x12: return '\"';
+  case 0x27: return 'F';
+  case 0x35: return '?';
+  case 0x37: return 'P';
+  case 0x50: return '1';
+  case 0x53: return '4';
+  case 0x57: return 'H';
+  case 0x70: return '7';
+  case 0x73: return 'Q';
+  case 0x76: return 'N';
+  case 0x77: return 'A';
+  case 0x80: return '_';
+  case 0x81: return '=';
+  case 0x86: return 'L';
+  case 0x87: return 'T';
+  case 0xA6: return 'C';
+  case 0xA7: return 'E';
+  case 0xB5: return '2';
+  case 0xC7: return 'B';
+  case 0xD3: return 'Y';
+  case 0xD5: return 'D';
+  case 0xD6: return 'U';
+  case 0xE3: return '5';
+  case 0xE6: return 'G';
+  case 0xE7: return '6';
+  case 0xF0: return ']';
+  case 0xF1: return '3';
+  case 0xF3: return '9';
+  case 0xF4: return 'J';
+  case 0xF5: return '@';
+  case 0xF6: return 'O';
+  case 0xF7: return '8';
+  default:   return '?';
+  }
+}
+
+static uint8_t oldPrefix(uint16_t seg) {
+  switch (seg)
+  {
+  case 0x2288: return PFX_R_EDGE;
+  case 0x8282: return PFX_F_EDGE;
+  case 0x0145: return PFX_V;
+  case 0xc080: return PFX_MICRO;
+  case 0x4480: return PFX_NANO;
+  case 0xD480: return PFX_D;
+  case 0x0E80: return PFX_KILO;
+  case 0x5125: return PFX_MEGA;
+  case 0x4494: return PFX_MILLI;
+  case 0x3600: return PFX_DEGREE;
+  case 0xC7D3: return PFX_PERCENT;
+  default:     return PFX_NONE;
+  }
+}
+
+static uint8_t oldUnit(uint16_t seg) {
+  switch (seg)
+  {
+  case 0x2288: return UNIT_R_EDGE;
+  case 0x8282: return UNIT_F_EDGE;
+  case 0x217:  return UNIT_P;
+  case 0x5415: return UNIT_H;
+  case 0x2017: return UNIT_F;
+  case 0xF68A: return UNIT_B;
+  case 0x0145: return UNIT_V;
+  case 0x7417: return UNIT_A;
+  case 0x7007: return UNIT_OHM;
+  case 0xA00F: return UNIT_C;
+  default:     return UNIT_NONE;
+  }
+}
+
+// every input of the three tables against the switches above, returns the number of differences
+static unsigned selftest() {
+  unsigned bad = 0, v;
+
+  for ( v=0; v<256 ; v++){
+    if (sevenSeg2char(v) != oldSevenSeg2char(v))
+    {
+      fprintf(stderr, "digit 0x%02x : '%c' instead of '%c'\n", v, sevenSeg2char(v), oldSevenSeg2char(v));
+      bad++;
+    }
+  }
+  for ( v=0; v<65536 ; v++){
+    if (segLookup(prefixTable, v) != oldPrefix(v))
+    {
+      fprintf(stderr, "prefix 0x%04x : %u instead of %u\n", v, segLookup(prefixTable, v), oldPrefix(v));
+      bad++;
+    }
+    if (segLookup(unitTable, v) != oldUnit(v))
+    {
+      fprintf(stderr, "unit 0x%04x : %u instead of %u\n", v, segLookup(unitTable, v), oldUnit(v));
+      bad++;
+    }
+  }
+  fprintf(stderr, "selftest : 256 digit codes, 65536 prefix and unit values, %u differences\n", bad);
+  return bad;
+}
+
+static void decodePart(Part *p, int output, bool check) {
+  DisplayState ds;
+  Reading r;
+  size_t i;
+
+  decodeFrames(p->frames, p->n, p->out);
+  if (check)
+  {
+    for ( i=0; i<p->n ; i++){
+      decodeFrame(p->frames + i * FRAME_SIZE, &ds);
+      readingOf(&ds, &r);
+      if (memcmp(&r, &p->out[i], sizeof(Reading)) != 0) p->mismatches++;
+    }
+  }
+  if (output == OUT_CSV)
+  {
+    p->text.clear();
+    for ( i=0; i<p->n ; i++) csvLine(p->text, p->out[i]);
+  }
+}
+
+int main(int argc, char **argv) {
+  unsigned threads = std::thread::hardware_concurrency();
+  int      output = OUT_CSV;
+  bool     check = false;
+  const char *path = NULL;
+  int      a;
+
+  for ( a=1; a<argc ; a++){
+    if (!strcmp(argv[a], "-j") && a + 1 < argc) threads = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "-b")) output = OUT_BINARY;
+    else if (!strcmp(argv[a], "-n")) output = OUT_NONE;
+    else if (!strcmp(argv[a], "--check")) check = true;
+    else if (!strcmp(argv[a], "--selftest")) return selftest() != 0;
+    else path = argv[a];
+  }
+  if (!path)
+  {
+    fprintf(stderr, "usage: decode_log [-j threads] [-b | -n] [--check] frames.bin | --selftest\n");
+    return 2;
+  }
+  if (threads == 0) threads = 1;
+
+  FILE *in = fopen(path, "rb");
+  if (!in)
+  {
+    perror(path);
+    return 1;
+  }
+
+  std::vector<uint8_t> frames(BLOCK * FRAME_SIZE);
+  std::vector<Reading> readings(BLOCK);
+  std::vector<Part> parts(threads);
+  std::vector<std::thread> workers;
+  size_t total = 0, mismatches = 0, n, per, k;
+  auto start = std::chrono::steady_clock::now();
+
+  if (output == OUT_CSV) printf("value,exp,unit,prefix,flags\n");
+  while ((n = fread(frames.data(), FRAME_SIZE, BLOCK, in)) > 0)
+  {
+    per = (n + threads - 1) / threads;
+    for ( k=0; k<threads ; k++){
+      Part &p = parts[k];
+      size_t first = k * per < n ? k * per : n;
+      p.frames = frames.data() + first * FRAME_SIZE;
+      p.n = first + per < n ? per : n - first;
+      p.out = readings.data() + first;
+      p.mismatches = 0;
+      workers.emplace_back(decodePart, &p, output, check);
+    }
+    for (auto &w : workers) w.join();
+    workers.clear();
+
+    for ( k=0; k<threads ; k++){
+      mismatches += parts[k].mismatches;
+      if (output == OUT_CSV) fwrite(parts[k].text.data(), 1, parts[k].text.size(), stdout);
+    }
+    if (output == OUT_BINARY) fwrite(readings.data(), sizeof(Reading), n, stdout);
+    total += n;
+  }
+  fclose(in);
+
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "%zu frames in %.2f s (%.1f M frames/s, %u threads)\n", total, s, total / s / 1e6, threads);
+  if (check)
+  {
+    fprintf(stderr, "check : %zu frames decoded differently from the sketch\n", mismatches);
+    return mismatches != 0;
+  }
+  return 0;
+}
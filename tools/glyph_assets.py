@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+# Compiles the glyph bitmaps of assets/glyphs into PM2525_glyphs.h, the XBM arrays drawn with drawXBMP().
+# They go to flash (PROGMEM) instead of being copied in the 2 KB of SRAM at startup.
+#
+#   python3 tools/glyph_assets.py > PM2525_glyphs.h
+#   python3 tools/glyph_assets.py --font > PM2525_glyphs.h
+#
+# assets/glyphs/glyphs.txt gives the order and a description of each glyph, <name>.xbm its bitmap. The
+# header starts with the size of each glyph as XBM and RLE compressed the way u8g2 stores its fonts.
+# With --font the glyphs are also written as a u8g2 font, pm2525_glyphs_font, one character per glyph
+# (GLYPH_<name>), drawn with the bottom left corner on y : drawGlyph(x, y + <name>_height, GLYPH_<name>).
+
+import os
+import re
+import sys
+
+ASSETS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "assets", "glyphs")
+FIRST_CODE = ord("A")
+
+
+def load(directory):
+    glyphs = []
+    for line in open(os.path.join(directory, "glyphs.txt")):
+        line = line.split("#")[0].strip()
+        if not line:
+            continue
+        name, _, desc = line.partition(" ")
+        src = open(os.path.join(directory, name + ".xbm")).read()
+        w = int(re.search(r"_width\s+(\d+)", src).group(1))
+        h = int(re.search(r"_height\s+(\d+)", src).group(1))
+        data = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]+", src.split("{", 1)[1])]
+        if len(data) != (w + 7) // 8 * h:
+            sys.exit("%s.xbm : %d bytes for %dx%d" % (name, len(data), w, h))
+        pix = [[(data[y * ((w + 7) // 8) + x // 8] >> (x & 7)) & 1 for x in range(w)] for y in range(h)]
+        glyphs.append((name, desc.strip(), w, h, data, pix))
+    return glyphs
+
+
+class BitWriter:
+    # u8g2 bitstream, LSB first
+    def __init__(self):
+        self.bits = []
+
+    def u(self, v, cnt):
+        self.bits += [(v >> i) & 1 for i in range(cnt)]
+
+    def s(self, v, cnt):
+        self.u(v + (1 << (cnt - 1)), cnt)
+
+    def data(self):
+        b = self.bits + [0] * (-len(self.bits) % 8)
+        return bytes(sum(b[i + j] << j for j in range(8)) for i in range(0, len(b), 8))
+
+
+def signed_bits(values):
+    n = 1
+    while any(v < -(1 << (n - 1)) or v >= (1 << (n - 1)) for v in values):
+        n += 1
+    return n
+
+
+def unsigned_bits(values):
+    return max(1, max(values).bit_length())
+
+
+def runs(pix, bp0, bp1):
+    # (zeros, ones) pairs covering the glyph row by row, each count limited to its number of bits
+    flat = [p for row in pix for p in row]
+    out, i = [], 0
+    while i < len(flat):
+        a = 0
+        while i < len(flat) and not flat[i] and a < (1 << bp0) - 1:
+            a, i = a + 1, i + 1
+        b = 0
+        while i < len(flat) and flat[i] and b < (1 << bp1) - 1:
+            b, i = b + 1, i + 1
+        out.append((a, b))
+    return out
+
+
+def encode_glyph(g, bits, bp0, bp1):
+    name, desc, w, h, data, pix = g
+    bw, bh, bx, by, bd = bits
+    out = BitWriter()
+    out.u(w, bw)
+    out.u(h, bh)
+    out.s(0, bx)                                  # x offset
+    out.s(0, by)                                  # y offset, bottom of the glyph on the baseline
+    out.s(w + 1, bd)                              # advance
+    pairs = runs(pix, bp0, bp1)
+    i = 0
+    while i < len(pairs):
+        out.u(pairs[i][0], bp0)
+        out.u(pairs[i][1], bp1)
+        while i + 1 < len(pairs) and pairs[i + 1] == pairs[i]:   # same pair again : one bit
+            out.u(1, 1)
+            i += 1
+        out.u(0, 1)
+        i += 1
+    return out.data()
+
+
+def font(glyphs):
+    bits = (unsigned_bits([g[2] for g in glyphs]), unsigned_bits([g[3] for g in glyphs]),
+            signed_bits([0]), signed_bits([0]), signed_bits([g[2] + 1 for g in glyphs]))
+    best = None
+    for bp0 in range(2, 8):                       # the run length sizes giving the smallest font
+        for bp1 in range(1, 8):
+            enc = [encode_glyph(g, bits, bp0, bp1) for g in glyphs]
+            size = sum(len(e) + 2 for e in enc)
+            if best is None or size < best[0]:
+                best = (size, bp0, bp1, enc)
+    size, bp0, bp1, enc = best
+
+    body = b""
+    for n, e in enumerate(enc):
+        body += bytes([FIRST_CODE + n, len(e) + 2]) + e
+    end = len(body)
+    body += b"\0\0"
+    maxw = max(g[2] for g in glyphs)
+    maxh = max(g[3] for g in glyphs)
+    lower_a = end if FIRST_CODE + len(glyphs) <= ord("a") else 0
+    header = bytes([len(glyphs), 0, bp0, bp1] + list(bits) + [maxw, maxh, 0, 0, maxh, 0, maxh, 0,
+                   0, 0, lower_a >> 8, lower_a & 0xff, end >> 8, end & 0xff])
+    return header + body, enc
+
+
+def c_bytes(data, indent):
+    lines = []
+    for i in range(0, len(data), 12):
+        lines.append(indent + ", ".join("0x%02x" % v for v in data[i:i + 12]))
+    return ",\n".join(lines)
+
+
+def main():
+    args = sys.argv[1:]
+    with_font = "--font" in args
+    args = [a for a in args if a != "--font"]
+    glyphs = load(args[0] if args else ASSETS)
+    if FIRST_CODE + len(glyphs) > 127:
+        sys.exit("too many glyphs for one font")
+    fontdata, enc = font(glyphs)
+
+    print("// generated by tools/glyph_assets.py from assets/glyphs, do not edit")
+    print("//")
+    print("// glyph      size   xbm  rle")
+    for g, e in zip(glyphs, enc):
+        print("// %-10s %2dx%-2d %4d %4d" % (g[0], g[2], g[3], len(g[4]), len(e) + 2))
+    print("// total            %4d %4d bytes of flash, rle as a u8g2 font with %d bytes of header and end mark"
+          % (sum(len(g[4]) for g in glyphs), len(fontdata), len(fontdata) - sum(len(e) + 2 for e in enc)))
+    for name, desc, w, h, data, pix in glyphs:
+        print()
+        print("   // %s" % desc)
+        print("    #define %s_width %d" % (name, w))
+        print("    #define %s_height %d" % (name, h))
+        print("    static const unsigned char %s_bits[] PROGMEM = {" % name)
+        print(c_bytes(data, "    ") + "};")
+
+    if with_font:
+        print()
+        print("   // the same glyphs as a u8g2 font")
+        for n, g in enumerate(glyphs):
+            print("    #define GLYPH_%s %d" % (g[0], FIRST_CODE + n))
+        print("    const uint8_t pm2525_glyphs_font[%d] U8G2_FONT_SECTION(\"pm2525_glyphs_font\") = {" % len(fontdata))
+        print(c_bytes(fontdata, "    ") + "};")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,70 @@
+// Host stand-in for the Arduino core, see tools/render_check.py. Enough of it for the sketch built with
+// FRAME_REPLAY on a PC : flash is ordinary memory, the interrupts are not there, millis() is the clock of
+// host.cpp and Serial goes to stderr.
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_ptr(p) (*(const void * const *)(p))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+    typedef bool boolean;
+    typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define SDA 18
+#define SCL 19
+#define DEC 10
+#define HEX 16
+#define F_CPU 16000000UL
+
+unsigned long millis();
+unsigned long micros();
+inline void noInterrupts() {}
+inline void interrupts() {}
+inline void delay(unsigned long) {}
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+class Print {
+ public:
+  size_t write(uint8_t c);
+  size_t print(const char *s);
+  size_t print(const __FlashStringHelper *s) { return print((const char *)s); }
+  size_t print(char c) { return write(c); }
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(long n, int base = DEC) { return n < 0 ? print('-') + print((unsigned long)-n, base) : print((unsigned long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t println() { return write('\n'); }
+  template <typename T> size_t println(T v) { return print(v) + println(); }
+  template <typename T> size_t println(T v, int base) { return print(v, base) + println(); }
+};
+
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long) {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int availableForWrite() { return 64; }
+  void flush() {}
+};
+extern HardwareSerial Serial;
+
+#endif
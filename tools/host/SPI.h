@@ -0,0 +1 @@
+// Host stand-in, see tools/render_check.py
@@ -0,0 +1,77 @@
+// Host stand-in for the U8g2 Arduino class, see tools/render_check.py. Only the SSD1322 256x64 constructors
+// exist. Drawing goes to a real page buffer with the layout, rotation and clipping of u8g2, and the page
+// buffer goes to an emulated SSD1322 memory through the same tile and command calls, so the screen the
+// sketch builds can be read back with hostScreen().
+
+#ifndef U8G2LIB_H
+#define U8G2LIB_H
+
+#include <Arduino.h>
+#include "u8g2.h"
+
+#define HOST_W 256
+#define HOST_H 64
+
+class U8G2 : public Print {
+ protected:
+  u8g2_t   u8g2;
+  uint8_t  buffer[HOST_W * 8];
+
+  void pixel(int16_t x, int16_t y, uint8_t color);
+  void updatePageWin();
+  void sendRows(uint8_t first, uint8_t rows);
+
+ public:
+  U8G2(const u8g2_cb_t *rotation, uint8_t tileRows);
+
+  u8x8_t *getU8x8() { return &u8g2.u8x8; }
+  u8g2_t *getU8g2() { return &u8g2; }
+
+  bool begin();
+  void setBusClock(uint32_t) {}
+  void setPowerSave(uint8_t is_enable);
+  void setContrast(uint8_t) {}
+
+  void firstPage();
+  uint8_t nextPage();
+  void clearBuffer();
+  void sendBuffer();
+  void setBufferCurrTileRow(uint8_t row);
+  uint8_t *getBufferPtr() { return buffer; }
+  uint8_t getBufferTileHeight() { return u8g2.tile_buf_height; }
+  uint8_t getBufferTileWidth() { return HOST_W / 8; }
+
+  void setFont(const uint8_t *font) { u8g2.font = font; }
+  void setFontMode(uint8_t mode) { u8g2.font_mode = mode; }
+  void setDrawColor(uint8_t color) { u8g2.draw_color = color; }
+  void setBitmapMode(uint8_t mode) { u8g2.bitmap_transparency = mode; }
+
+  uint16_t drawGlyph(int16_t x, int16_t y, uint16_t encoding);
+  int16_t drawStr(int16_t x, int16_t y, const char *s);
+  void drawXBMP(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *bitmap);
+  void drawXBM(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *bitmap) { drawXBMP(x, y, w, h, bitmap); }
+  void drawBox(int16_t x, int16_t y, int16_t w, int16_t h);
+  void drawHLine(int16_t x, int16_t y, int16_t w) { drawBox(x, y, w, 1); }
+  void drawVLine(int16_t x, int16_t y, int16_t h) { drawBox(x, y, 1, h); }
+  void drawPixel(int16_t x, int16_t y) { pixel(x, y, u8g2.draw_color); }
+
+  int16_t getDisplayWidth() { return HOST_W; }
+  int16_t getDisplayHeight() { return HOST_H; }
+};
+
+class U8G2_SSD1322_NHD_256X64_1_4W_HW_SPI : public U8G2 {
+ public: U8G2_SSD1322_NHD_256X64_1_4W_HW_SPI(const u8g2_cb_t *r, uint8_t, uint8_t, uint8_t = 255) : U8G2(r, 1) {}
+};
+class U8G2_SSD1322_NHD_256X64_2_4W_HW_SPI : public U8G2 {
+ public: U8G2_SSD1322_NHD_256X64_2_4W_HW_SPI(const u8g2_cb_t *r, uint8_t, uint8_t, uint8_t = 255) : U8G2(r, 2) {}
+};
+class U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI : public U8G2 {
+ public: U8G2_SSD1322_NHD_256X64_F_4W_HW_SPI(const u8g2_cb_t *r, uint8_t, uint8_t, uint8_t = 255) : U8G2(r, 8) {}
+};
+
+    // what the emulated SSD1322 shows, gray levels 0..15 in display memory coordinates, and whether it is on
+    extern uint8_t hostScreen[HOST_H][HOST_W];
+    extern bool hostPanelOn;
+    extern uint32_t hostSpiBytes;      // bytes through the byte callback since boot, commands included
+
+#endif
@@ -0,0 +1,18 @@
+// Host stand-in for the Wire library, see tools/render_check.py : the frames come from replayData[]
+// (FRAME_REPLAY), the bus itself is never used.
+
+#ifndef WIRE_H
+#define WIRE_H
+
+#include <Arduino.h>
+
+class TwoWire {
+ public:
+  void begin(uint8_t) {}
+  void onReceive(void (*)(int)) {}
+  int available() { return 0; }
+  int read() { return -1; }
+};
+extern TwoWire Wire;
+
+#endif
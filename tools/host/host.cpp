@@ -0,0 +1,471 @@
+// Host side of tools/render_check.py : the Arduino and u8g2 calls of the sketch on a PC, an emulated SSD1322
+// memory behind them and a main() rendering every frame of replayData[].
+//
+//   host [-n frames] [-p ms] [-o dir]
+//
+// Runs setup(), then loop() n times (the sketch is built with FRAME_REPLAY and REPLAY_PERIOD 0 so every
+// loop() replays one frame), the clock moving by -p ms (30 by default) each time, then renders the
+// DisplayStates of synthState() with renderState(), which reach the characters, units, annunciators and
+// bargraph changes the replayed frames don't. After each frame the screen is written to dir/frameNNN.pbm as seen by the user (the
+// panel is mounted upside down), then the whole screen is drawn again with transcode() and compared with
+// what the dirty tile path left. One line per frame on stdout :
+//
+//   frame <n> us <wall time of loop()> spi <bytes sent> full <ok | differs>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include <Wire.h>
+
+#include "../../PM2525_decode.h"
+
+// ************************* Arduino ***********************
+
+    HardwareSerial Serial;
+    TwoWire Wire;
+    static unsigned long hostMillis = 0;
+
+unsigned long millis() {
+  return hostMillis;
+}
+
+unsigned long micros() {
+  return hostMillis * 1000;
+}
+
+size_t Print::write(uint8_t c) {
+  fputc(c, stderr);
+  return 1;
+}
+
+size_t Print::print(const char *s) {
+  return fputs(s, stderr) >= 0 ? strlen(s) : 0;
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return fprintf(stderr, base == HEX ? "%lX" : "%lu", n);
+}
+
+// ************************* SSD1322 ***********************
+// Follows the commands u8g2 and the sketch send : column window 0x15, row window 0x75, write RAM 0x5C then
+// 2 pixels per byte, left one in the high nibble, display off 0xAE and on 0xAF. Arguments and pixel data both
+// come with DC high as on the real controller.
+
+    uint8_t  hostScreen[HOST_H][HOST_W];
+    bool     hostPanelOn = true;
+    uint32_t hostSpiBytes = 0;
+
+    static struct {
+      uint8_t dc, cmd, args, arg[2];
+      uint8_t c0, c1, r0, r1;          // write window, columns of 4 pixels and rows
+      uint8_t col, row, half;          // write position, half is the byte of the column (2 per column)
+    } panel;
+
+static void panelData(u8x8_t *u8x8, uint8_t b) {
+  int16_t x = (panel.col - u8x8->x_offset) * 4 + panel.half * 2;
+
+  if (panel.cmd != 0x5c)
+  {
+    if (panel.args < 2) panel.arg[panel.args] = b;
+    if (++panel.args < 2) return;
+    if (panel.cmd == 0x15) { panel.c0 = panel.col = panel.arg[0]; panel.c1 = panel.arg[1]; panel.half = 0; }
+    if (panel.cmd == 0x75) { panel.r0 = panel.row = panel.arg[0]; panel.r1 = panel.arg[1]; }
+    return;
+  }
+  if (x >= 0 && x + 1 < HOST_W && panel.row < HOST_H)
+  {
+    hostScreen[panel.row][x] = b >> 4;
+    hostScreen[panel.row][x + 1] = b & 0x0f;
+  }
+  if (++panel.half < 2) return;
+  panel.half = 0;
+  if (panel.col++ < panel.c1) return;
+  panel.col = panel.c0;
+  if (panel.row++ < panel.r1) return;
+  panel.row = panel.r0;
+}
+
+static uint8_t panelByte(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr) {
+  const uint8_t *p = (const uint8_t *)arg_ptr;
+  uint8_t i;
+
+  switch (msg)
+  {
+  case U8X8_MSG_BYTE_SET_DC:
+    panel.dc = arg_int;
+    break;
+  case U8X8_MSG_BYTE_SEND:
+    hostSpiBytes += arg_int;
+    for ( i=0; i<arg_int ; i++){
+      if (panel.dc) panelData(u8x8, p[i]);
+      else
+      {
+        panel.cmd = p[i];
+        panel.args = 0;
+        if (p[i] == 0xae) hostPanelOn = false;
+        if (p[i] == 0xaf) hostPanelOn = true;
+        if (p[i] == 0x5c) { panel.col = panel.c0; panel.row = panel.r0; panel.half = 0; }
+      }
+    }
+    break;
+  }
+  return 1;
+}
+
+// ************************* u8x8 ***********************
+
+uint8_t u8x8_cad_StartTransfer(u8x8_t *u8x8) {
+  return u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_START_TRANSFER, 0, NULL);
+}
+
+uint8_t u8x8_cad_EndTransfer(u8x8_t *u8x8) {
+  return u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_END_TRANSFER, 0, NULL);
+}
+
+uint8_t u8x8_cad_SendCmd(u8x8_t *u8x8, uint8_t cmd) {
+  u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SET_DC, 0, NULL);
+  return u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SEND, 1, &cmd);
+}
+
+uint8_t u8x8_cad_SendArg(u8x8_t *u8x8, uint8_t arg) {
+  u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SET_DC, 1, NULL);
+  return u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SEND, 1, &arg);
+}
+
+uint8_t u8x8_cad_SendData(u8x8_t *u8x8, uint8_t cnt, uint8_t *data) {
+  u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SET_DC, 1, NULL);
+  return u8x8->byte_cb(u8x8, U8X8_MSG_BYTE_SEND, cnt, data);
+}
+
+// cnt tiles from tile column x of tile row y, as the SSD1322 driver of u8x8 sends them : a 2 column by 8 row
+// window per tile, then its 8 rows of 4 bytes
+uint8_t u8x8_DrawTile(u8x8_t *u8x8, uint8_t x, uint8_t y, uint8_t cnt, uint8_t *tile_ptr) {
+  uint8_t  data[32];
+  uint8_t  col = x * 2 + u8x8->x_offset;
+  uint8_t  r, k;
+
+  u8x8_cad_StartTransfer(u8x8);
+  for ( ; cnt ; cnt--, col += 2, tile_ptr += 8){
+    u8x8_cad_SendCmd(u8x8, 0x15);
+    u8x8_cad_SendArg(u8x8, col);
+    u8x8_cad_SendArg(u8x8, col + 1);
+    u8x8_cad_SendCmd(u8x8, 0x75);
+    u8x8_cad_SendArg(u8x8, y * 8);
+    u8x8_cad_SendArg(u8x8, y * 8 + 7);
+    u8x8_cad_SendCmd(u8x8, 0x5c);
+    for ( r=0; r<8 ; r++)
+      for ( k=0; k<4 ; k++)
+        data[r*4 + k] = (tile_ptr[k*2] >> r & 1 ? 0xf0 : 0) | (tile_ptr[k*2 + 1] >> r & 1 ? 0x0f : 0);
+    u8x8_cad_SendData(u8x8, 32, data);
+  }
+  u8x8_cad_EndTransfer(u8x8);
+  return 1;
+}
+
+// ************************* u8g2 ***********************
+
+    const u8g2_cb_t u8g2_cb_r0 = {0};
+    const u8g2_cb_t u8g2_cb_r2 = {2};
+
+U8G2::U8G2(const u8g2_cb_t *rotation, uint8_t tileRows) {
+  memset(&u8g2, 0, sizeof(u8g2));
+  u8g2.u8x8.x_offset = 0x1c;           // NHD 256x64 : the panel starts at SSD1322 column 28
+  u8g2.u8x8.byte_cb = panelByte;
+  u8g2.cb = rotation;
+  u8g2.tile_buf_ptr = buffer;
+  u8g2.tile_buf_height = tileRows;
+  u8g2.draw_color = 1;
+  updatePageWin();
+}
+
+bool U8G2::begin() {
+  memset(hostScreen, 0, sizeof(hostScreen));
+  setPowerSave(0);
+  return true;
+}
+
+void U8G2::setPowerSave(uint8_t is_enable) {
+  u8x8_cad_StartTransfer(&u8g2.u8x8);
+  u8x8_cad_SendCmd(&u8g2.u8x8, is_enable ? 0xae : 0xaf);
+  u8x8_cad_EndTransfer(&u8g2.u8x8);
+}
+
+// user_y0..user_y1 is the part of the screen held by the buffer, drawing coordinates
+void U8G2::updatePageWin() {
+  int16_t y0 = u8g2.tile_curr_row * 8, y1 = y0 + u8g2.tile_buf_height * 8;
+
+  if (y1 > HOST_H) y1 = HOST_H;
+  u8g2.user_x0 = 0;
+  u8g2.user_x1 = HOST_W;
+  u8g2.user_y0 = u8g2.cb->rotation == 2 ? HOST_H - y1 : y0;
+  u8g2.user_y1 = u8g2.cb->rotation == 2 ? HOST_H - y0 : y1;
+}
+
+void U8G2::setBufferCurrTileRow(uint8_t row) {
+  u8g2.tile_curr_row = row;
+  updatePageWin();
+}
+
+void U8G2::clearBuffer() {
+  memset(buffer, 0, HOST_W * u8g2.tile_buf_height);
+}
+
+void U8G2::sendRows(uint8_t first, uint8_t rows) {
+  uint8_t r;
+
+  for ( r=0; r<rows && first + r < HOST_H / 8 ; r++)
+    u8x8_DrawTile(&u8g2.u8x8, 0, first + r, HOST_W / 8, buffer + r * HOST_W);
+}
+
+void U8G2::sendBuffer() {
+  sendRows(u8g2.tile_curr_row, u8g2.tile_buf_height);
+}
+
+void U8G2::firstPage() {
+  setBufferCurrTileRow(0);
+  clearBuffer();
+}
+
+uint8_t U8G2::nextPage() {
+  uint8_t row;
+
+  sendBuffer();
+  row = u8g2.tile_curr_row + u8g2.tile_buf_height;
+  if (row >= HOST_H / 8)
+  {
+    setBufferCurrTileRow(0);
+    return 0;
+  }
+  setBufferCurrTileRow(row);
+  clearBuffer();
+  return 1;
+}
+
+// one pixel in drawing coordinates, clipped to the part of the screen in the buffer
+void U8G2::pixel(int16_t x, int16_t y, uint8_t color) {
+  uint8_t *p, bit;
+
+  if (x < u8g2.user_x0 || x >= u8g2.user_x1 || y < u8g2.user_y0 || y >= u8g2.user_y1) return;
+  if (u8g2.cb->rotation == 2)
+  {
+    x = HOST_W - 1 - x;
+    y = HOST_H - 1 - y;
+  }
+  p = buffer + (y / 8 - u8g2.tile_curr_row) * HOST_W + x;
+  bit = 1 << (y & 7);
+  if (color == 0) *p &= ~bit;
+  else if (color == 1) *p |= bit;
+  else *p ^= bit;
+}
+
+void U8G2::drawBox(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t i, j;
+
+  for ( j=0; j<h ; j++)
+    for ( i=0; i<w ; i++) pixel(x + i, y + j, u8g2.draw_color);
+}
+
+// XBM rows, LSB first. The 0 bits are drawn in the other color unless the bitmap mode is transparent
+void U8G2::drawXBMP(int16_t x, int16_t y, int16_t w, int16_t h, const uint8_t *bitmap) {
+  int16_t  i, j, pitch = (w + 7) / 8;
+  uint8_t  color = u8g2.draw_color, other = color == 0 ? 1 : 0;
+
+  for ( j=0; j<h ; j++)
+    for ( i=0; i<w ; i++){
+      if (bitmap[j * pitch + i / 8] >> (i & 7) & 1) pixel(x + i, y + j, color);
+      else if (!u8g2.bitmap_transparency) pixel(x + i, y + j, other);
+    }
+}
+
+    // u8g2 glyph bitstream, LSB first
+    struct FontBits {
+      const uint8_t *p;
+      uint8_t bit;
+      unsigned u(uint8_t cnt) {
+        unsigned v = *p >> bit;
+        if (bit + cnt >= 8) { p++; v |= *p << (8 - bit); bit += cnt - 8; }
+        else bit += cnt;
+        return v & ((1u << cnt) - 1);
+      }
+      int s(uint8_t cnt) { return (int)u(cnt) - (1 << (cnt - 1)); }
+    };
+
+// the glyph with its origin on x, y (baseline), returns the advance, 0 for a character missing from the font
+uint16_t U8G2::drawGlyph(int16_t x, int16_t y, uint16_t encoding) {
+  const uint8_t *f = u8g2.font, *g = f + 23;
+  FontBits b;
+  unsigned w, h, cx = 0, cy = 0, a, c, n;
+  int      gx, gy, dx;
+  uint8_t  fg = u8g2.draw_color, bg = fg == 0 ? 1 : 0;
+
+  if (!f || encoding > 0xff) return 0;
+  if (encoding >= 'a') g += f[19] << 8 | f[20];
+  else if (encoding >= 'A') g += f[17] << 8 | f[18];
+  for (;;)
+  {
+    if (g[1] == 0) return 0;
+    if (g[0] == encoding) break;
+    g += g[1];
+  }
+
+  b.p = g + 2;
+  b.bit = 0;
+  w = b.u(f[4]);
+  h = b.u(f[5]);
+  gx = b.s(f[6]);
+  gy = b.s(f[7]);
+  dx = b.s(f[8]);
+  x += gx;
+  y -= h + gy;                         // top of the glyph
+  while (w && cy < h)
+  {
+    a = b.u(f[2]);
+    c = b.u(f[3]);
+    do {
+      for ( n=0; n<a + c ; n++){
+        if (n >= a) pixel(x + cx, y + cy, fg);
+        else if (u8g2.font_mode == 0) pixel(x + cx, y + cy, bg);
+        if (++cx == w) { cx = 0; cy++; }
+      }
+    } while (b.u(1));
+  }
+  return dx;
+}
+
+int16_t U8G2::drawStr(int16_t x, int16_t y, const char *s) {
+  int16_t w = 0;
+
+  for ( ; *s ; s++) w += drawGlyph(x + w, y, (uint8_t)*s);
+  return w;
+}
+
+// ************************* main ***********************
+
+void setup();
+void loop();
+void renderState(const DisplayState *next);
+void transcode(const DisplayState *ds);
+extern DisplayState shown;
+
+// bargraph masks, bit n lighting BAR(n) : the replayed frames only grow the bar, these also shrink it and
+// extend it on both sides, which changes the join column between two dots
+    static const uint32_t barStates[] = {
+      0x0001e,                         // 1..4
+      0x0001c,                         // 2..4, loses its leftmost dot
+      0x0001e,                         // 1..4, extends to the left
+      0x0000e,                         // 1..3, loses its rightmost dot
+      0x01fe0,                         // 5..12
+      0x01ff8,                         // 3..12, extends 2 dots to the left
+      0x01fc0,                         // 6..12
+      0x0aaaa,                         // every other dot, no run
+      0x1ffff,                         // all, end marks included
+      0x0fffe,                         // 1..15
+      0x00000,
+    };
+    #define SYNTH_STATES (12 + sizeof(barStates) / sizeof(barStates[0]))
+
+// lights the bargraph positions of mask in annun[], the way barMask() reads them back
+static void barState(uint32_t mask, DisplayState *ds) {
+  static const uint8_t screenBits[8] = {0x02, 0x01, 0x04, 0x08, 0x80, 0x40, 0x10, 0x20};  // frame[8] / frame[7] bits
+  uint8_t i;
+
+  if (mask & 1) ds->annun[ANN_F19] |= 0x20;
+  for ( i=0; i<8 ; i++){
+    if (mask & (2ul << i)) ds->annun[ANN_F8] |= screenBits[i];
+    if (mask & (0x200ul << i)) ds->annun[ANN_F7] |= screenBits[i];
+  }
+}
+
+// DisplayStates the replayed frames don't reach : every prefix, unit and readout character, all the
+// annunciators on then half of them, then the bargraph changes of barStates[]
+static void synthState(uint8_t k, DisplayState *ds) {
+  static const char chars[] = " 0123456789-'R.\"F?PHQNA_=LTCEBYDUG]J@O";
+  uint8_t i;
+
+  memset(ds, 0, sizeof(*ds));
+  if (k >= 12)
+  {
+    for ( i=0; i<7 ; i++) ds->digits[i] = '0' + i;
+    barState(barStates[k - 12], ds);
+    return;
+  }
+  for ( i=0; i<ANN_COUNT ; i++) ds->annun[i] = k == 0 ? 0xff : (k & 1 ? 0x55 : 0xaa) ^ (i * 0x11);
+  for ( i=0; i<7 ; i++) ds->digits[i] = chars[(k * 7 + i) % (sizeof(chars) - 1)];
+  ds->dp = 1 << (k % 7);
+  ds->polarity = k % 3;
+  ds->prefix = k;
+  ds->unit = k % 11;
+}
+
+static void writePbm(const char *dir, unsigned n) {
+  char     path[512];
+  uint8_t  row[HOST_W / 8];
+  int      x, y;
+  FILE     *f;
+
+  snprintf(path, sizeof(path), "%s/frame%03u.pbm", dir, n);
+  f = fopen(path, "wb");
+  if (!f)
+  {
+    perror(path);
+    exit(1);
+  }
+  fprintf(f, "P4\n%d %d\n", HOST_W, HOST_H);
+  for ( y=0; y<HOST_H ; y++){
+    memset(row, 0, sizeof(row));
+    for ( x=0; x<HOST_W ; x++)         // upside down, as the user sees it, lit pixels black
+      if (hostScreen[HOST_H - 1 - y][HOST_W - 1 - x]) row[x / 8] |= 0x80 >> (x & 7);
+    fwrite(row, sizeof(row), 1, f);
+  }
+  fclose(f);
+}
+
+int main(int argc, char **argv) {
+  unsigned frames = 8, period = 30, n, total;
+  const char *dir = NULL;
+  static uint8_t drawn[HOST_H][HOST_W];
+  DisplayState ds;
+  int      a, x, y;
+  bool     same;
+
+  for ( a=1; a<argc ; a++){
+    if (!strcmp(argv[a], "-n") && a + 1 < argc) frames = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "-p") && a + 1 < argc) period = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "-o") && a + 1 < argc) dir = argv[++a];
+    else
+    {
+      fprintf(stderr, "usage: host [-n frames] [-p ms] [-o dir]\n");
+      return 2;
+    }
+  }
+
+  setup();
+  total = frames + SYNTH_STATES;
+  for ( n=0; n<total ; n++){
+    uint32_t bytes = hostSpiBytes;
+    hostMillis += period;
+    auto t = std::chrono::steady_clock::now();
+    if (n < frames) loop();
+    else
+    {
+      synthState(n - frames, &ds);
+      renderState(&ds);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t).count();
+    bytes = hostSpiBytes - bytes;
+
+    memcpy(drawn, hostScreen, sizeof(drawn));
+    if (dir) writePbm(dir, n);
+    transcode(&shown);                 // the whole screen again, the dirty tiles must have given the same
+    same = true;
+    for ( y=0; y<HOST_H ; y++)
+      for ( x=0; x<HOST_W ; x++)
+        if ((drawn[y][x] != 0) != (hostScreen[y][x] != 0)) same = false;
+    printf("frame %u us %.1f spi %lu full %s\n", n, us, (unsigned long)bytes, same ? "ok" : "differs");
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+// Host stand-in for the part of the u8g2 C library the sketch uses, see tools/render_check.py. The structures
+// only have the fields the sketch reads, the functions are in host.cpp.
+
+#ifndef U8G2_H
+#define U8G2_H
+
+#include <stdint.h>
+
+#define U8G2_FONT_SECTION(name)
+
+    typedef struct u8x8_struct u8x8_t;
+    typedef uint8_t (*u8x8_msg_cb)(u8x8_t *u8x8, uint8_t msg, uint8_t arg_int, void *arg_ptr);
+
+    // messages of the byte callback, same values as u8x8.h
+    #define U8X8_MSG_BYTE_INIT            20
+    #define U8X8_MSG_BYTE_SEND            23
+    #define U8X8_MSG_BYTE_START_TRANSFER  24
+    #define U8X8_MSG_BYTE_END_TRANSFER    25
+    #define U8X8_MSG_BYTE_SET_DC          32
+
+    struct u8x8_struct {
+      uint8_t  x_offset;               // first display memory column, in the units of the controller
+      u8x8_msg_cb byte_cb;             // sends the bytes to the emulated SSD1322
+    };
+
+    struct u8g2_cb_struct { uint8_t rotation; };
+    typedef struct u8g2_cb_struct u8g2_cb_t;
+    extern const u8g2_cb_t u8g2_cb_r0, u8g2_cb_r2;
+    #define U8G2_R0 (&u8g2_cb_r0)
+    #define U8G2_R2 (&u8g2_cb_r2)
+
+    struct u8g2_struct {
+      u8x8_t   u8x8;
+      const u8g2_cb_t *cb;
+      uint8_t  *tile_buf_ptr;
+      uint8_t  tile_buf_height;        // tile rows held by the buffer
+      uint8_t  tile_curr_row;          // first of them, display memory coordinates
+      int16_t  user_x0, user_x1, user_y0, user_y1;   // part of the screen in the buffer, drawing coordinates
+      const uint8_t *font;
+      uint8_t  font_mode;              // 0 solid, 1 transparent
+      uint8_t  bitmap_transparency;
+      uint8_t  draw_color;
+    };
+    typedef struct u8g2_struct u8g2_t;
+
+uint8_t u8x8_DrawTile(u8x8_t *u8x8, uint8_t x, uint8_t y, uint8_t cnt, uint8_t *tile_ptr);
+uint8_t u8x8_cad_StartTransfer(u8x8_t *u8x8);
+uint8_t u8x8_cad_EndTransfer(u8x8_t *u8x8);
+uint8_t u8x8_cad_SendCmd(u8x8_t *u8x8, uint8_t cmd);
+uint8_t u8x8_cad_SendArg(u8x8_t *u8x8, uint8_t arg);
+uint8_t u8x8_cad_SendData(u8x8_t *u8x8, uint8_t cnt, uint8_t *data);
+
+    // the fonts of the sketch, tools/render_check.py compiles them from the stand-in fonts or a u8g2_fonts.c
+    extern const uint8_t u8g2_font_tom_thumb_4x6_tr[];
+    extern const uint8_t u8g2_font_inr19_mf[];
+    extern const uint8_t u8g2_font_inr16_mf[];
+    extern const uint8_t u8g2_font_10x20_mf[];
+    extern const uint8_t u8g2_font_9x15_mf[];
+
+#endif
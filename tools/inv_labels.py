@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+# Generates PM2525_labels.h : the inverted annunciators (SHFT, LIM, DELTA%...) pre-rendered as DrawInvStr()
+# draws them, a 7 pixel high box with the u8g2_font_tom_thumb_4x6_tr text cleared in it. They are stored in
+# the u8g2 page buffer format and upside down for U8G2_R2, so drawInvLabel() only ORs bytes into the page
+# buffer instead of switching font, font mode and draw color for a box and a string on every page.
+#
+#   python3 tools/inv_labels.py <U8g2 library>/src/clib/u8g2_fonts.c > PM2525_labels.h
+#
+# The labels are the annunText[] of every K_INV entry of annunDesc[] in the sketch, indexed by their T_xx
+# id. Run it again after changing them. Without PM2525_labels.h the sketch uses DrawInvStr() as before.
+
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from readout_sprites import font_bytes, glyphs        # noqa: E402
+
+FONT = "u8g2_font_tom_thumb_4x6_tr"
+HEIGHT = 7                    # box of DrawInvStr() : y - 6 .. y
+SKETCH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "PM2525_OLED.c")
+
+
+def labels():
+    # [(T_xx id name, text)] from the first inverted id to the last one, in enum order
+    src = open(SKETCH, encoding="latin-1").read()
+    ids = re.findall(r"\bT_\w+", re.search(r"enum\s*\{\s*(T_REM\b.*?)\}", src, re.S).group(1))
+    texts = re.findall(r'"([^"]*)"', re.search(r"annunText\[\]\[\d+\] PROGMEM = \{(.*?)\};", src, re.S).group(1))
+    if len(ids) != len(texts):
+        sys.exit("%d T_xx ids for %d annunText[] strings" % (len(ids), len(texts)))
+    inv = {ids.index(t) for t in re.findall(r"K_INV,\s*(T_\w+)\}", src)}
+    return list(zip(ids, texts))[min(inv):max(inv) + 1]
+
+
+def render(text, g):
+    # columns of the box, rightmost first, bit 0 is the bottom row (what U8G2_R2 puts on top)
+    width = 4 * len(text) + 2
+    on = {(x, y) for x in range(width) for y in range(HEIGHT)}
+    cursor = 2                                        # the text origin is 2 pixels inside the box
+    for c in text:
+        pix, adv = g[ord(c)]
+        on -= {(cursor + x, HEIGHT - 1 + y) for x, y in pix}
+        cursor += adv
+    return [sum(1 << (HEIGHT - 1 - y) for y in range(HEIGHT) if (x, y) in on) for x in reversed(range(width))]
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: inv_labels.py <U8g2 library>/src/clib/u8g2_fonts.c > PM2525_labels.h")
+    g = glyphs(font_bytes(sys.argv[1], FONT))
+    lab = labels()
+    missing = sorted({c for _, text in lab for c in text if ord(c) not in g})
+    if missing:
+        sys.exit("not in %s : %s" % (FONT, " ".join(missing)))
+
+    print("// generated by tools/inv_labels.py from %s, do not edit" % FONT)
+    print("// the inverted annunciators as DrawInvStr() draws them, in the u8g2 page buffer format (one byte per")
+    print("// pixel column), upside down for U8G2_R2 : column 0 is the rightmost one of the box, bit 0 its bottom row.")
+    print()
+    print("#define INV_LABELS")
+    print("#define INV_LABEL_H %d                // rows of the box, y - 6 .. y" % HEIGHT)
+    print("#define INV_LABEL_FIRST %s" % lab[0][0])
+    print("#define INV_LABEL_LAST %s" % lab[-1][0])
+    for ident, text in lab:
+        cols = render(text, g)
+        print()
+        print("    // %s" % text)
+        print("    static const uint8_t %s_label[] PROGMEM = {" % ident[2:])
+        print(",\n".join("    " + ", ".join("0x%02x" % v for v in cols[i:i + 12]) for i in range(0, len(cols), 12)) + "};")
+    print()
+    print("    struct InvLabel { uint8_t w; const uint8_t *cols; };")
+    print("    const InvLabel invLabels[] PROGMEM = {")
+    print(",\n".join("      {%d, %s_label}" % (4 * len(text) + 2, ident[2:]) for ident, text in lab) + "};")
+
+
+if __name__ == "__main__":
+    main()
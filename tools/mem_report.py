@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# SRAM and flash used by each part of the sketch, from the symbols of the compiled ELF.
+#
+#   arduino-cli compile -b arduino:avr:nano --output-dir build .
+#   python3 tools/mem_report.py build/PM2525_OLED.ino.elf [-v]
+#
+# Uses avr-nm (set NM=... to use another one). Variables (.data, .bss) count in SRAM, initialised ones
+# also in flash for their start value, code and PROGMEM tables count in flash. The stack and the heap
+# come out of what is left of the 2 KB. -v lists the symbols of each part, largest first.
+
+import os
+import re
+import subprocess
+import sys
+
+SRAM = 2048
+FLASH = 30720                    # 32 KB minus the bootloader
+
+# first match wins, symbol names are demangled
+PARTS = [
+    ("u8g2 display",       r"u8g2|u8x8|U8G2|U8X8|^buf(\.\d+)?$|^u8g2_m_"),
+    ("fonts",              r"_font_|readoutSprites|readoutIndex"),
+    ("glyphs",             r"_bits$|annunXbm|invLabels|_label$"),
+    ("annunciators",       r"annun|prefixChar|unitChar"),
+    ("Wire / TWI",         r"TwoWire|^Wire$|^twi_|rxBuffer|txBuffer|TWI_vect|__vector_24$|twiBegin"),
+    ("Serial",             r"HardwareSerial|^Serial|__vector_1[89]$|__vector_20$|Print::|Print$"),
+    ("PCF8576 emulation",  r"^pcf|receiveEvent|blinkUpdate|panelOn"),
+    ("frame buffers",      r"^frame|fillSlot|readySlot|^shown|^value$|stateBox|displayReady"),
+    ("rendering",          r"transcode|renderState|drawState|DrawInvStr|blitReadout|sendDirect|dirtyTiles|direct|markDirty|"
+                           r"markChanges|markDirect|markReadout|markCell|annunBox|drawInvLabel|drawBar|barMask|[Tt]rend|decodeFrame|sevenSeg2char"),
+    ("diagnostics",        r"^stage|[Pp]rofile|^tx|record|replay|^rxCycles|Stats|^spiBytes|^drawCalls|^render|"
+                           r"printScreenCrc|^frames|[Bb]ench|^stack|sramPeak|__vector_13$"),
+    ("Arduino core",       r"."),
+]
+
+
+def symbols(elf):
+    nm = os.environ.get("NM", "avr-nm")
+    out = subprocess.run([nm, "-S", "-C", "--size-sort", elf], capture_output=True, text=True, check=True).stdout
+    for line in out.splitlines():
+        m = re.match(r"([0-9a-fA-F]+)\s+([0-9a-fA-F]+)\s+(\w)\s+(.*)", line)
+        if m:
+            yield m.group(4), int(m.group(2), 16), m.group(3).lower()
+
+
+def main():
+    args = [a for a in sys.argv[1:] if a != "-v"]
+    verbose = "-v" in sys.argv
+    if len(args) != 1:
+        sys.exit("usage: mem_report.py <sketch.elf> [-v]")
+
+    parts = {name: [0, 0, []] for name, _ in PARTS}
+    for sym, size, kind in symbols(args[0]):
+        name = next(n for n, pat in PARTS if re.search(pat, sym.split("(")[0]))
+        if kind in "bdv":                         # .bss / .data / weak object
+            parts[name][0] += size
+        if kind in "dvtrw":                       # code, PROGMEM, start values of .data
+            parts[name][1] += size
+        parts[name][2].append((size, kind, sym))
+
+    print("%-20s %6s %7s" % ("", "SRAM", "flash"))
+    for name, _ in PARTS:
+        sram, flash, syms = parts[name]
+        if not syms:
+            continue
+        print("%-20s %6d %7d" % (name, sram, flash))
+        if verbose:
+            for size, kind, sym in sorted(syms, reverse=True):
+                print("    %5d %s %s" % (size, kind, sym))
+    sram = sum(p[0] for p in parts.values())
+    flash = sum(p[1] for p in parts.values())
+    print("%-20s %6d %7d" % ("total", sram, flash))
+    print("%-20s %6d %7d" % ("left", SRAM - sram, FLASH - flash))
+    print("(left SRAM is for the stack and the heap, the symbols don't include the vector table and padding)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,129 @@
+// Stress test of the DUAL_CORE hand over (PM2525_pipeline.h) on a PC, with two threads standing for the two
+// cores of the RP2040 : one decodes frames (decodeFrame() of PM2525_decode.h) and publishes the DisplayStates,
+// the other takes them and "renders" them by spending the given time on each one.
+//
+//   g++ -O2 -std=c++11 -pthread -o pipeline_stress tools/pipeline_stress.cpp
+//   ./pipeline_stress [-n frames] [-r render_us] [-d decode_us] [frames.bin]
+//
+// frames.bin is a capture of 20 byte frames as for decode_log, replayed in a loop, random frames without it.
+// Every published state carries its number and a checksum : the consumer checks that it never gets a state
+// being written (checksum) and never an older one than the last (number), and counts the states skipped
+// because a newer one replaced them. With -r longer than -d most of them are. Also worth running once built
+// with -fsanitize=thread. Exits with 1 when a check failed.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "../PM2525_decode.h"
+#include "../PM2525_pipeline.h"
+
+struct Item {
+  uint32_t seq;                        // 1, 2, 3... in publishing order
+  DisplayState ds;
+  uint32_t sum;                        // of seq and ds, written last
+  std::chrono::steady_clock::time_point published;
+};
+
+static uint32_t itemSum(const Item &it) {
+  const uint8_t *p = (const uint8_t *)&it.ds;
+  uint32_t s = it.seq * 2654435761u;
+  size_t i;
+
+  for ( i=0; i<sizeof(DisplayState) ; i++) s = (s ^ p[i]) * 16777619u;
+  return s;
+}
+
+static void spin(unsigned us) {
+  auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+  while (std::chrono::steady_clock::now() < end) {}
+}
+
+int main(int argc, char **argv) {
+  unsigned long n = 1000000;
+  unsigned render = 0, decode = 0;
+  const char *path = NULL;
+  std::vector<uint8_t> frames;
+  int a;
+
+  for ( a=1; a<argc ; a++){
+    if (!strcmp(argv[a], "-n") && a + 1 < argc) n = strtoul(argv[++a], NULL, 0);
+    else if (!strcmp(argv[a], "-r") && a + 1 < argc) render = atoi(argv[++a]);
+    else if (!strcmp(argv[a], "-d") && a + 1 < argc) decode = atoi(argv[++a]);
+    else path = argv[a];
+  }
+  if (path)
+  {
+    FILE *in = fopen(path, "rb");
+    uint8_t f[FRAME_SIZE];
+    if (!in)
+    {
+      perror(path);
+      return 1;
+    }
+    while (fread(f, FRAME_SIZE, 1, in) == 1) frames.insert(frames.end(), f, f + FRAME_SIZE);
+    fclose(in);
+  }
+  if (frames.empty())
+  {
+    srand(1);
+    for ( a=0; a<4096*FRAME_SIZE ; a++) frames.push_back(rand());
+  }
+  size_t count = frames.size() / FRAME_SIZE;
+
+  LatestBox<Item> box;
+  std::atomic<bool> done(false);
+  unsigned long taken = 0, torn = 0, backwards = 0;
+  uint32_t last = 0;
+  double latency = 0, latencyMax = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  std::thread producer([&] {         // core 0 : receive and decode
+    unsigned long i;
+    for ( i=0; i<n ; i++){
+      Item &it = box.back();
+      it.seq = i + 1;
+      decodeFrame(&frames[(i % count) * FRAME_SIZE], &it.ds);
+      it.sum = itemSum(it);
+      it.published = std::chrono::steady_clock::now();
+      box.publish();
+      if (decode) spin(decode);
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  std::thread consumer([&] {         // core 1 : render
+    bool last_round = false;
+    for (;;)
+    {
+      if (!box.take())
+      {
+        if (last_round) break;
+        last_round = done.load(std::memory_order_acquire);   // one more take() for the last state
+        continue;
+      }
+      const Item &it = box.front();
+      double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - it.published).count();
+      latency += us;
+      if (us > latencyMax) latencyMax = us;
+      if (itemSum(it) != it.sum) torn++;
+      if (it.seq <= last) backwards++;
+      last = it.seq;
+      taken++;
+      if (render) spin(render);
+    }
+  });
+
+  producer.join();
+  consumer.join();
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%lu published, %lu rendered, %lu skipped in %.2f s\n", n, taken, n - taken, s);
+  printf("publish to render : mean %.1f us, max %.1f us\n", taken ? latency / taken : 0, latencyMax);
+  printf("torn %lu, out of order %lu, last %s\n", torn, backwards, last == n ? "rendered" : "lost");
+  return torn || backwards || last != n;
+}
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+# Generates PM2525_readout.h : the characters of the main readout (u8g2_font_inr19_mf) pre-rendered in the
+# u8g2 page buffer format, already turned upside down for U8G2_R2 and placed on the readout baseline, so the
+# sketch only ORs bytes into the page buffer instead of decoding the font 8 times per frame.
+#
+#   python3 tools/readout_sprites.py <U8g2 library>/src/clib/u8g2_fonts.c > PM2525_readout.h
+#
+# The character set is read from segChars[] in PM2525_decode.h, plus '0' and the sign characters.
+# Run it again after changing the font, the baseline or segChars[]. Without PM2525_readout.h the
+# sketch draws the readout with drawStr() as before.
+
+import re
+import sys
+import os
+
+FONT = "u8g2_font_inr19_mf"
+BASELINE = 13 + 36            # LAY.readY of the SSD1322 layout
+SKETCH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "PM2525_decode.h")
+
+
+def font_bytes(path, name):
+    # the font is a list of C string literals after its declaration
+    src = open(path, encoding="latin-1").read()
+    m = re.search(r"\b" + name + r"\b\s*\[[^\]]*\][^=]*=(.*?);", src, re.S)
+    if not m:
+        sys.exit("%s not found in %s" % (name, path))
+    data = b""
+    for lit in re.findall(r'"((?:[^"\\]|\\.)*)"', m.group(1), re.S):
+        data += lit.encode("latin-1").decode("unicode_escape").encode("latin-1")
+    return data
+
+
+class Bits:
+    # u8g2 glyph bitstream, LSB first
+    def __init__(self, data, pos):
+        self.data, self.pos, self.bit = data, pos, 0
+
+    def u(self, cnt):
+        val = self.data[self.pos] >> self.bit
+        if self.bit + cnt >= 8:
+            self.pos += 1
+            val |= self.data[self.pos] << (8 - self.bit)
+            self.bit += cnt - 8
+        else:
+            self.bit += cnt
+        return val & ((1 << cnt) - 1)
+
+    def s(self, cnt):
+        return self.u(cnt) - (1 << (cnt - 1))
+
+
+def glyphs(font):
+    # {encoding: (pixels set of (x, y) relative to origin and baseline, y down, advance)}
+    bp0, bp1, bpw, bph, bpx, bpy, bpd = font[2:9]
+    out = {}
+    pos = 23
+    while font[pos + 1] != 0:
+        enc, nxt = font[pos], font[pos + 1]
+        b = Bits(font, pos + 2)
+        w, h = b.u(bpw), b.u(bph)
+        gx, gy, adv = b.s(bpx), b.s(bpy), b.s(bpd)
+        pix = set()
+        if w:
+            x = y = 0
+            while y < h:
+                a, c = b.u(bp0), b.u(bp1)
+                while True:
+                    for n, on in ((a, False), (c, True)):
+                        for _ in range(n):
+                            if on:
+                                pix.add((gx + x, y - (h + gy)))
+                            x += 1
+                            if x >= w:
+                                x, y = 0, y + 1
+                    if b.u(1) == 0:
+                        break
+        out[enc] = (pix, adv)
+        pos += nxt
+    return out
+
+
+def charset():
+    src = open(SKETCH, encoding="latin-1").read()
+    body = src[src.index("segChars[] = {"):]
+    body = body[:body.index("};")]
+    chars = {c.encode("latin-1").decode("unicode_escape") for c in re.findall(r"'((?:\\.|[^'])+)'\}", body)}
+    return sorted(chars | set("0+-"))
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: readout_sprites.py <U8g2 library>/src/clib/u8g2_fonts.c > PM2525_readout.h")
+    g = glyphs(font_bytes(sys.argv[1], FONT))
+    chars = [c for c in charset() if ord(c) in g]
+    missing = [c for c in charset() if ord(c) not in g]
+
+    allpix = [p for c in chars for p in g[ord(c)][0]]
+    x0 = min([x for x, y in allpix] + [0])
+    x1 = max([x for x, y in allpix] + [0])
+    width = x1 - x0 + 1
+    # physical rows of the readout, the screen is 64 high and upside down
+    rows = [63 - (BASELINE + y) for x, y in allpix]
+    ty0, ty1 = min(rows) >> 3, max(rows) >> 3
+    advance = {g[ord(c)][1] for c in chars}
+    if len(advance) != 1:
+        sys.exit("%s is expected to be monospaced" % FONT)
+
+    print("// generated by tools/readout_sprites.py from %s, do not edit" % FONT)
+    print("// characters of the main readout in the u8g2 page buffer format (one byte per pixel column, bit 0")
+    print("// on top), upside down for U8G2_R2. Sprite column 0 is the rightmost one on the screen.")
+    if missing:
+        print("// not in the font : %s" % " ".join(missing))
+    print()
+    print("#define READOUT_SPRITES")
+    print("#define READOUT_BASELINE %d          // drawing coordinates" % BASELINE)
+    print("#define READOUT_ADVANCE %d           // pixels from one character to the next" % advance.pop())
+    print("#define READOUT_SPRITE_X %d          // first column from the character origin" % x0)
+    print("#define READOUT_SPRITE_W %d" % width)
+    print("#define READOUT_SPRITE_TY0 %d         // first tile row, display memory coordinates" % ty0)
+    print("#define READOUT_SPRITE_ROWS %d        // tile rows per sprite" % (ty1 - ty0 + 1))
+    print()
+    print("    // sprite of ASCII 32..127, 0xff when it isn't in the sheet")
+    index = [chars.index(chr(i)) if chr(i) in chars else 0xff for i in range(32, 128)]
+    print("    const uint8_t readoutIndex[96] PROGMEM = {")
+    for i in range(0, 96, 16):
+        print("      " + ", ".join("0x%02x" % v for v in index[i:i + 16]) + ("," if i < 80 else "};"))
+    print()
+    print("    const uint8_t readoutSprites[][READOUT_SPRITE_ROWS][READOUT_SPRITE_W] PROGMEM = {")
+    for n, c in enumerate(chars):
+        pix = g[ord(c)][0]
+        print("      {   // %r" % c)
+        for ty in range(ty0, ty1 + 1):
+            col = []
+            for k in range(width):
+                x = x1 - k                       # mirrored
+                v = 0
+                for bit in range(8):
+                    y = 63 - (ty * 8 + bit) - BASELINE
+                    if (x, y) in pix:
+                        v |= 1 << bit
+                col.append("0x%02x" % v)
+            print("        {" + ", ".join(col) + "}" + ("," if ty < ty1 else ""))
+        print("      }" + ("," if n < len(chars) - 1 else "};"))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,308 @@
+#!/usr/bin/env python3
+# Renders the sketch on a PC : builds PM2525_OLED.c with g++ against the stand-ins of tools/host (Arduino
+# core, u8g2 with its page buffer, an SSD1322 memory), replays every frame of replayData[] through it and
+# writes each screen as a 256x64 PBM, as the user sees it.
+#
+#   python3 tools/render_check.py [-o dir] [--fonts <U8g2 library>/src/clib/u8g2_fonts.c] [--update]
+#
+# The sketch is built with FRAME_REPLAY and REPLAY_PERIOD 0 in several variants : page buffer of 1, 2 and 8
+# tile rows, without DIRTY_TILES, with SSD1322_DIRECT, with PM2525_readout.h and PM2525_labels.h generated
+# by tools/readout_sprites.py and tools/inv_labels.py from the fonts of the run, and with TREND. The others
+# draw the readout and the inverted annunciators with the fonts, so the pre-rendered ones are checked
+# against them. TREND takes one sample per TREND_PERIOD ms into a ring of TREND_W columns, its variant replays
+# the frames in a loop, one sample each, for a few sweeps of the ring. After the replayed frames come a few DisplayStates reaching every unit, prefix, readout
+# character and annunciator, then bargraph runs shrinking and extending on both sides (see host.cpp), as the
+# replayed frames only grow the bar. It fails when
+#   - a variant gives another screen than the first one (all but TREND must draw the same pixels),
+#   - the dirty tile redraw of a frame leaves another screen than drawing it whole,
+#   - a screen has another CRC32 than in tools/host/golden.txt.
+# --update writes the CRCs of this run to golden.txt instead, after a change meant to alter the screen.
+# dir (render_out by default) gets the build, one directory of PBMs per variant and times.csv : wall time of
+# each frame on this PC (the render path as compiled for it, not the Nano) and the bytes sent to the SSD1322.
+#
+# The u8g2 fonts are not part of this repository. Without --fonts the sketch is built with stand-in fonts
+# (a 3x5 pixel font at the size of each u8g2 one) which golden.txt is for. With the u8g2_fonts.c of the
+# library the screens are the real ones and are only compared between variants, and PM2525_readout.h /
+# PM2525_labels.h, when present next to the sketch, are checked to be what the generators give for them.
+
+import os
+import re
+import shutil
+import subprocess
+import sys
+import zlib
+
+TOOLS = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.join(TOOLS, "..")
+HOST = os.path.join(TOOLS, "host")
+GOLDEN = os.path.join(HOST, "golden.txt")
+sys.path.insert(0, TOOLS)
+from glyph_assets import BitWriter, runs, signed_bits, unsigned_bits     # noqa: E402
+from readout_sprites import font_bytes                                   # noqa: E402
+
+# name: (defines set (None comments the line out), generated headers, golden set)
+VARIANTS = [
+    ("page", {}, False, "screen"),
+    ("page2", {"BUFFER_TILE_ROWS": "2"}, False, "screen"),
+    ("full", {"BUFFER_TILE_ROWS": "8"}, False, "screen"),
+    ("nodirty", {"DIRTY_TILES": None}, False, "screen"),
+    ("direct", {"SSD1322_DIRECT": ""}, False, "screen"),
+    ("sprites", {}, True, "screen"),
+    ("trend", {"TREND": ""}, False, "trend"),
+]
+OPTIONAL = ("PM2525_readout.h", "PM2525_labels.h")     # generated headers the sketch picks up when present
+GENERATED = {"PM2525_readout.h": "readout_sprites.py", "PM2525_labels.h": "inv_labels.py"}
+
+# stand-in fonts : the 3x5 glyphs below scaled to about the size of the u8g2 font, (scale, advance, last code)
+FONTS = {
+    "u8g2_font_tom_thumb_4x6_tr": (1, 4, 127),
+    "u8g2_font_inr19_mf": (4, 17, 255),         # advances of LAY.digitPitch and unit2X - unitX
+    "u8g2_font_inr16_mf": (3, 14, 255),
+}
+GLYPHS = {
+    "0": "### #.# #.# #.# ###", "1": ".#. ##. .#. .#. ###", "2": "### ..# ### #.. ###",
+    "3": "### ..# .## ..# ###", "4": "#.# #.# ### ..# ..#", "5": "### #.. ### ..# ###",
+    "6": "### #.. ### #.# ###", "7": "### ..# .#. .#. .#.", "8": "### #.# ### #.# ###",
+    "9": "### #.# ### ..# ###", "A": ".#. #.# ### #.# #.#", "B": "##. #.# ##. #.# ##.",
+    "C": ".## #.. #.. #.. .##", "D": "##. #.# #.# #.# ##.", "E": "### #.. ### #.. ###",
+    "F": "### #.. ### #.. #..", "G": ".## #.. #.# #.# .##", "H": "#.# #.# ### #.# #.#",
+    "I": "### .#. .#. .#. ###", "J": "..# ..# ..# #.# .#.", "K": "#.# #.# ##. #.# #.#",
+    "L": "#.. #.. #.. #.. ###", "M": "#.# ### ### #.# #.#", "N": "##. #.# #.# #.# #.#",
+    "O": ".#. #.# #.# #.# .#.", "P": "##. #.# ##. #.. #..", "Q": ".#. #.# #.# ##. .##",
+    "R": "##. #.# ##. #.# #.#", "S": ".## #.. .#. ..# ##.", "T": "### .#. .#. .#. .#.",
+    "U": "#.# #.# #.# #.# ###", "V": "#.# #.# #.# #.# .#.", "W": "#.# #.# ### ### #.#",
+    "X": "#.# #.# .#. #.# #.#", "Y": "#.# #.# .#. .#. .#.", "Z": "### ..# .#. #.. ###",
+    "d": "..# ..# .## #.# .##", "k": "#.. #.# ##. #.# #.#", "m": "... ##. ### #.# #.#",
+    "n": "... ##. #.# #.# #.#", "w": "... #.# #.# ### ###", "%": "#.# ..# .#. #.. #.#",
+    "+": "... .#. ### .#. ...", "-": "... ... ### ... ...", ".": "... ... ... ... .#.",
+    "'": ".#. .#. ... ... ...", '"': "#.# #.# ... ... ...", "_": "... ... ... ... ###",
+    "=": "... ### ... ### ...", "?": "##. ..# .#. ... .#.", "@": "### #.# ### #.. .##",
+    "]": ".## ..# ..# ..# .##", "\xb5": "... #.# #.# ##. #..", "\xb0": "### #.# ### ... ...",
+    " ": "",
+}
+
+
+def encode_font(scale, advance, last):
+    glyphs = []                                   # (code, w, h, pixel rows)
+    for c in sorted(GLYPHS, key=ord):
+        if ord(c) > last:
+            continue
+        rows = [[p == "#" for p in row for _ in range(scale)] for row in GLYPHS[c].split() for _ in range(scale)]
+        glyphs.append((ord(c), len(rows[0]) if rows else 0, len(rows), rows))
+    bits = (unsigned_bits([g[1] for g in glyphs]), unsigned_bits([g[2] for g in glyphs]),
+            signed_bits([0]), signed_bits([0]), signed_bits([advance]))
+    bp0, bp1 = 4, 4
+    body, upper_a, lower_a = b"", None, None
+    for code, w, h, rows in glyphs:
+        out = BitWriter()
+        out.u(w, bits[0])
+        out.u(h, bits[1])
+        out.s(0, bits[2])                         # x offset
+        out.s(0, bits[3])                         # y offset, bottom of the glyph on the baseline
+        out.s(advance, bits[4])
+        pairs = runs(rows, bp0, bp1) if w else []
+        i = 0
+        while i < len(pairs):
+            out.u(pairs[i][0], bp0)
+            out.u(pairs[i][1], bp1)
+            while i + 1 < len(pairs) and pairs[i + 1] == pairs[i]:
+                out.u(1, 1)
+                i += 1
+            out.u(0, 1)
+            i += 1
+        if upper_a is None and code >= ord("A"):
+            upper_a = len(body)
+        if lower_a is None and code >= ord("a"):
+            lower_a = len(body)
+        data = out.data()
+        body += bytes([code, len(data) + 2]) + data
+    end = len(body)
+    body += b"\0\0"
+    upper_a = end if upper_a is None else upper_a
+    lower_a = end if lower_a is None else lower_a
+    w, h = 3 * scale, 5 * scale
+    header = bytes([len(glyphs), 0, bp0, bp1] + list(bits) + [w, h, 0, 0, h, 0, h, 0,
+                   upper_a >> 8, upper_a & 0xff, lower_a >> 8, lower_a & 0xff, end >> 8, end & 0xff])
+    return header + body
+
+
+def write_fonts(path, fonts):
+    # as in u8g2_fonts.c : C string literals, read back by font_bytes() of the generators
+    with open(path, "w", encoding="latin-1") as f:
+        f.write("// fonts of the sketch for tools/render_check.py, generated\n#include \"u8g2.h\"\n")
+        for name, data in fonts.items():
+            f.write('\nconst uint8_t %s[%d] U8G2_FONT_SECTION("%s") = \n' % (name, len(data) + 1, name))
+            f.write("\n".join('  "%s"' % "".join("\\x%02x" % b for b in data[i:i + 32])
+                              for i in range(0, len(data), 32)) + ";\n")
+
+
+def sketch_source(defines, headers):
+    src = open(os.path.join(ROOT, "PM2525_OLED.c"), encoding="latin-1").read().replace("\r\n", "\n")
+    sets = dict(defines, FRAME_REPLAY="", REPLAY_PERIOD="0")
+    for name, value in sets.items():
+        line = "//#define %s" % name if value is None else ("#define %s %s" % (name, value)).rstrip()
+        src, n = re.subn(r"^(//)?#define %s\b.*$" % name, line, src, count=1, flags=re.M)
+        if not n:
+            sys.exit("no #define %s in the sketch" % name)
+    for name in OPTIONAL:
+        if not (headers and name in GENERATED):
+            src = src.replace('__has_include("%s")' % name, "0")
+    return src
+
+
+def prototypes(src, flags):
+    # what the Arduino builder does : a prototype of every function of the sketch before the first one
+    pre = subprocess.run(["g++", "-E", "-P", "-x", "c++", "-"] + flags, input=src, capture_output=True,
+                         text=True, encoding="latin-1").stdout
+    defs = r"^((?:static\s+|inline\s+)*[A-Za-z_][\w<>:\s\*&]*?[\s\*&]+([A-Za-z_]\w*)\s*\(([^;{)]*)\))\s*(?://[^\n]*)?\s*\{"
+    protos = []
+    for m in re.finditer(defs, src, re.M):
+        sig, name = m.group(1), m.group(2)
+        if name in ("if", "while", "for", "switch", "return") or "ISR" in sig or sig.lstrip().startswith(("else", "#")):
+            continue
+        if re.search(r"\b" + name + r"\s*\([^;{]*\)\s*\{", pre):
+            protos.append(re.sub(r"\s+", " ", sig) + ";")
+    first = min([m.start() for m in re.finditer(r"^(?:void|char|int|uint8_t|uint16_t|uint32_t|int32_t|bool|Box|static|inline)"
+                                                 r"\b[^;\n]*\([^;]*\)\s*(?://[^\n]*)?\s*\{", src, re.M)] or [0])
+    return src[:first] + "\n".join(protos) + "\n#line %d\n" % (src[:first].count("\n") + 1) + src[first:]
+
+
+def run(cmd, **kw):
+    r = subprocess.run(cmd, capture_output=True, text=True, **kw)
+    if r.returncode:
+        sys.exit("%s failed :\n%s%s" % (" ".join(cmd[:3]), r.stdout, r.stderr))
+    return r.stdout
+
+
+def replay_frames():
+    src = open(os.path.join(ROOT, "PM2525_OLED.c"), encoding="latin-1").read()
+    body = re.search(r"replayData\[\] PROGMEM = \{(.*?)\};", src, re.S).group(1)
+    data = [int(v, 0) for v in re.findall(r"0x[0-9a-fA-F]+|\d+", re.sub(r"//.*", "", body))]
+    i = n = 0
+    while data[i]:
+        i += data[i] + 1
+        n += 1
+    return n // 2                                 # two transactions a frame
+
+
+def trend_run():
+    # one replayed frame per TREND_PERIOD, for 3 sweeps of the ring and a few samples more : the dirty columns
+    # are checked across the wrap and with the scale settled
+    src = open(os.path.join(ROOT, "PM2525_OLED.c"), encoding="latin-1").read()
+    period = int(re.search(r"^#define TREND_PERIOD (\d+)", src, re.M).group(1))
+    width = int(re.search(r"^\s*#define TREND_W (\d+)", src, re.M).group(1))
+    return 3 * width + 5, period
+
+
+def main():
+    args = sys.argv[1:]
+    out, fonts_c, update = "render_out", None, False
+    while args:
+        a = args.pop(0)
+        if a == "-o" and args:
+            out = args.pop(0)
+        elif a == "--fonts" and args:
+            fonts_c = args.pop(0)
+        elif a == "--update":
+            update = True
+        else:
+            sys.exit("usage: render_check.py [-o dir] [--fonts u8g2_fonts.c] [--update]")
+    if update and fonts_c:
+        sys.exit("golden.txt is for the stand-in fonts, --update can't be used with --fonts")
+
+    build = os.path.join(out, "build")
+    os.makedirs(build, exist_ok=True)
+    fonts = {name: font_bytes(fonts_c, name) if fonts_c else encode_font(*spec) for name, spec in FONTS.items()}
+    fonts_path = os.path.join(build, "u8g2_fonts.c")
+    write_fonts(fonts_path, fonts)
+
+    inc = ["-I" + HOST, "-I" + ROOT]
+    cxx = ["g++", "-std=gnu++11", "-O2"]
+    objs = []
+    for src in (os.path.join(HOST, "host.cpp"), fonts_path):
+        obj = os.path.join(build, os.path.basename(src) + ".o")
+        run(cxx + inc + ["-x", "c++", "-c", src, "-o", obj])
+        objs.append(obj)
+
+    stale = 0
+    for name, tool in GENERATED.items():
+        text = run([sys.executable, os.path.join(TOOLS, tool), fonts_path])
+        open(os.path.join(build, name), "w").write(text)
+        committed = os.path.join(ROOT, name)
+        if fonts_c and os.path.exists(committed) and open(committed).read() != text:
+            print("%s is not what tools/%s gives for these fonts, run it again" % (name, tool))
+            stale += 1
+
+    frames = replay_frames()
+    runs = {"screen": (frames, 30), "trend": trend_run()}
+    crcs, results, bad = {}, {}, stale
+    times = ["variant,frame,us,spi"]
+    for name, defines, headers, golden in VARIANTS:
+        vdir = os.path.join(build, name)
+        pbm = os.path.join(out, name)
+        os.makedirs(vdir, exist_ok=True)
+        shutil.rmtree(pbm, ignore_errors=True)
+        os.makedirs(pbm)
+        if headers:
+            for h in GENERATED:
+                shutil.copy(os.path.join(build, h), vdir)
+        flags = ["-I" + vdir] + inc
+        src = prototypes(sketch_source(defines, headers), flags)
+        sketch = os.path.join(vdir, "PM2525_OLED.cpp")
+        open(sketch, "w", encoding="latin-1").write(src)
+        exe = os.path.join(vdir, "render")
+        run(cxx + flags + [sketch] + objs + ["-o", exe])
+
+        n, period = runs[golden]
+        lines = run([exe, "-n", str(n), "-p", str(period), "-o", pbm]).split()
+        rows = [lines[i:i + 8] for i in range(0, len(lines), 8)]
+        crcs[name] = [zlib.crc32(open(os.path.join(pbm, "frame%03d.pbm" % i), "rb").read()) for i in range(len(rows))]
+        us = [float(r[3]) for r in rows]
+        spi = [int(r[5]) for r in rows]
+        full = [int(r[1]) for r in rows if r[7] != "ok"]
+        times += ["%s,%s,%s,%s" % (name, r[1], r[3], r[5]) for r in rows]
+        results[name] = (golden, full)
+        print("%-8s %2d screens  us mean %7.1f max %7.1f  spi mean %6d max %6d" %
+              (name, len(rows), sum(us) / len(us), max(us), sum(spi) // len(spi), max(spi)))
+        for i in full:
+            print("  frame %d : the dirty tiles left another screen than a full redraw" % i)
+        bad += len(full)
+    open(os.path.join(out, "times.csv"), "w").write("\n".join(times) + "\n")
+
+    ref = VARIANTS[0][0]
+    for name, (golden, _) in results.items():
+        if golden == "screen" and name != ref:
+            diff = [i for i, (a, b) in enumerate(zip(crcs[ref], crcs[name])) if a != b]
+            for i in diff:
+                print("%s frame %d : another screen than %s" % (name, i, ref))
+            bad += len(diff)
+
+    sets = {}
+    for name, (golden, _) in results.items():
+        sets.setdefault(golden, crcs[name])
+    if update:
+        with open(GOLDEN, "w") as f:
+            f.write("# CRC32 of the PBM of each screen with the stand-in fonts, written by tools/render_check.py --update\n")
+            f.write("# %s replayed frames then the states of synthState()\n" %
+                    ", ".join("%d %s" % (runs[g][0], g) for g in sets))
+            for golden, values in sets.items():
+                f.writelines("%s %d %08x\n" % (golden, i, v) for i, v in enumerate(values))
+        print("%s updated" % GOLDEN)
+    elif not fonts_c:
+        ref_crc = {}
+        for line in open(GOLDEN):
+            if line.strip() and not line.startswith("#"):
+                golden, i, v = line.split()
+                ref_crc[(golden, int(i))] = int(v, 16)
+        for golden, values in sets.items():
+            for i, v in enumerate(values):
+                if ref_crc.get((golden, i)) != v:
+                    print("%s %d : CRC %08x, golden.txt has %s" % (golden, i, v, "%08x" % ref_crc[(golden, i)]
+                                                                 if (golden, i) in ref_crc else "nothing"))
+                    bad += 1
+    print("%s, screens in %s" % ("%d failure%s" % (bad, "" if bad == 1 else "s") if bad else "all good", out))
+    return 1 if bad else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,46 @@
+#!/usr/bin/env python3
+# Turns the TELEMETRY records sent by the sketch into CSV lines, one per reading :
+#
+#   stty -F /dev/ttyUSB0 115200 raw && python3 tools/telemetry_log.py < /dev/ttyUSB0 > readings.csv
+#   python3 tools/telemetry_log.py capture.bin
+#
+# Columns : micros() of the reading on the Arduino, value in the base unit (mV are written as V), unit, AC/DC/HOLD/REM/NULL/NAN flags, records the
+# sketch dropped just before this one. Bytes that don't make a valid record are skipped until the next one.
+
+import struct
+import sys
+
+PREFIX = ["", "", "", "V", "", "", "d", "", "", "", "deg", "%"]   # u n k M m are in the exponent already
+UNIT = ["", "", "", "P", "H", "F", "B", "V", "A", "Ohm", "C"]
+FLAGS = [(0x01, "NAN"), (0x02, "AC"), (0x04, "DC"), (0x08, "HOLD"), (0x10, "REM"), (0x20, "NULL")]
+SIZE = 15
+
+
+def records(stream):
+    buf = b""
+    while True:
+        data = stream.read(SIZE)
+        if not data:
+            return
+        buf += data
+        while len(buf) >= SIZE:
+            rec = buf[:SIZE]
+            if rec[0] != 0x5A or sum(rec[:-1]) & 0xff != rec[-1]:
+                buf = buf[1:]                     # out of sync, look for the next 0x5A
+                continue
+            buf = buf[SIZE:]
+            yield struct.unpack("<BBIibBBBB", rec)
+
+
+def main():
+    stream = open(sys.argv[1], "rb") if len(sys.argv) > 1 else sys.stdin.buffer
+    print("micros,value,unit,flags,lost")
+    for _, lost, t, v, exp, unit, prefix, flags, _ in records(stream):
+        name = (PREFIX[prefix] if prefix < len(PREFIX) else "?") + (UNIT[unit] if unit < len(UNIT) else "?")
+        value = "" if flags & 0x01 else ("%.*f" % (max(0, -exp), v * 10.0 ** exp))
+        print("%d,%s,%s,%s,%d" % (t, value, name, " ".join(n for b, n in FLAGS if flags & b), lost))
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()